@@ -30,380 +30,3127 @@
  *  THE SOFTWARE
  */
 
+#if defined(__linux__) && !defined(VEC2_NO_MMAP)
+#    ifndef _GNU_SOURCE
+#        define _GNU_SOURCE /* For mremap */
+#    endif
+#    include <sys/mman.h>
+#    include <unistd.h>
+#    define VEC2_HAVE_MREMAP
+#endif
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(VEC2_NO_THREADS)
+#    include <pthread.h>
+#    include <unistd.h>
+#    define VEC2_HAVE_PTHREADS
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include "cvec2.h"
 
-#define VEC2_INITIAL_CAPACITY   8
-#define VEC2_SWAP_SIZE          24
+#if defined(VEC2_NO_THREAD_CACHE)
+    /* Thread caches are disabled, so vectors that ask for one use the heap directly */
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#    define VEC2_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#    define VEC2_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#    define VEC2_THREAD_LOCAL __declspec(thread)
+#endif
+
+#define VEC2_INITIAL_CAPACITY   8
+#define VEC2_SWAP_SIZE          24
+#define VEC2_ARENA_BLOCK_SIZE   (64 * 1024)
+#define VEC2_MMAP_THRESHOLD     (2 * 1024 * 1024)
+#define VEC2_PAGE_SIZE          4096
+#define VEC2_HUGE_PAGE_SIZE     (2 * 1024 * 1024)
+#define VEC2_MMAP_MAX_SIZE      ((size_t)-1 - (2 * VEC2_HUGE_PAGE_SIZE))
+#define VEC2_MAX_ALIGN          sizeof(union _vec2_max_align)
+#define VEC2_FLAG_ALIGN_MASK    0x1f
+#define VEC2_CACHE_MIN_SIZE     64
+#define VEC2_CACHE_LIMIT        (4 * 1024 * 1024)
+#define VEC2_CACHE_MAX_SIZE     ((size_t)VEC2_CACHE_MIN_SIZE << (_VEC2_IMPL_CACHE_CLASSES - 1))
+#define VEC2_FILL_CHUNK_SIZE    1024
+#define VEC2_ROTATE_BUF_SIZE    256
+#define VEC2_RADIX_MAX_KEY_SIZE 8
+#define VEC2_SORT_MAX_THREADS   64
+#define VEC2_SORT_MIN_CHUNK     16384
+#define VEC2_SORT_MAX_RUNS      85
+#define VEC2_SORT_TMP_SIZE      64
+
+/* Scatters the elements in src into the digit buckets of dst, copying the elements using a
+ * constant size if possible */
+#define VEC2_RADIX_SCATTER(src, dst, len, size, digit) \
+    do \
+    { \
+        const unsigned char *el = (src); \
+        const unsigned char *end = (src) + ((len) * (size)); \
+        for (; el < end; el += (size)) \
+        { \
+            memcpy((dst) + (count[digit(el)]++ * (size)), el, size); \
+        } \
+    } while (0)
+
+/* Gets the radix sort digit of an element at offset off of the key: the byte at that offset, with the
+ * sign bit flipped so that negative numbers come first, and with all the bits of negative floats
+ * flipped so that they're ordered by descending magnitude */
+#define VEC2_RADIX_DIGIT(el) \
+    ((el)[off] ^ ((flip_negative && ((el)[msb_off] & 0x80)) ? 0xff : top_mask))
+
+/* Reverses the elements in [first, last] using constant sized copies, which compile to plain
+ * (unaligned) loads and stores */
+#define VEC2_REVERSE_FIXED(first, last, size) \
+    do \
+    { \
+        unsigned char lo_bytes[size], hi_bytes[size]; \
+        for (; (first) < (last); (first) += (size), (last) -= (size)) \
+        { \
+            memcpy(lo_bytes, first, size); \
+            memcpy(hi_bytes, last, size); \
+            memcpy(first, hi_bytes, size); \
+            memcpy(last, lo_bytes, size); \
+        } \
+    } while (0)
+
+#define VEC2_ROUND_UP(n, m)     ((((n) + ((m) - 1)) / (m)) * (m))
+
+#define VEC2_GET(vec_ptr, el_size, idx) (vec2_data(vec_ptr) + ((idx) * (el_size)))
+
+#define vec2_start(vec_ptr)             ((vec_ptr)->_start)
+#define vec2_mem(vec_ptr, el_size)      (vec2_data(vec_ptr) - (vec2_start(vec_ptr) * el_size))
+#define vec2_alloc(vec_ptr)             ((vec_ptr)->_alloc ? (vec_ptr)->_alloc : &_vec2_default_allocator)
+#define vec2_growth(vec_ptr)            ((vec_ptr)->_growth ? (vec_ptr)->_growth : &_vec2_default_growth)
+#define vec2_align(vec_ptr)             ((size_t)1 << ((vec_ptr)->_flags & VEC2_FLAG_ALIGN_MASK))
+#define vec2_borrowed(vec_ptr)          ((vec_ptr)->_flags & _VEC2_IMPL_FLAG_BORROWED)
+
+/* Over-aligned blocks of the default allocator start after an offset header, so they aren't the
+ * pointers that malloc returned and can't be exchanged with the caller */
+#define vec2_buffer_private(vec_ptr) \
+    ((vec2_alloc(vec_ptr) == &_vec2_default_allocator) && (vec2_align(vec_ptr) > VEC2_MAX_ALIGN))
+
+#define vec2_cache_backing(cache_ptr) \
+    ((cache_ptr)->_backing ? (cache_ptr)->_backing : &_vec2_default_allocator)
+
+#define vec2_mmap_huge(mmap_ptr, size) \
+    (((mmap_ptr)->_huge_threshold != 0) && ((size) >= (mmap_ptr)->_huge_threshold))
+
+#define VEC2_ARENA_HEADER_SIZE          VEC2_ROUND_UP(sizeof(struct _vec2_arena_block), VEC2_MAX_ALIGN)
+#define VEC2_ARENA_MEM(block_ptr)       ((unsigned char *)(block_ptr) + VEC2_ARENA_HEADER_SIZE)
+#define VEC2_ARENA_PADDING(block_ptr, align) \
+    (((align) - ((size_t)(VEC2_ARENA_MEM(block_ptr) + (block_ptr)->used) % (align))) % (align))
+
+/**
+ * Definition of the generic vec structure used by the code in this file.
+ */
+struct _vec2_impl_struct VEC2_BODY(unsigned char);
+
+/**
+ * A union of the types with the strictest alignment requirements, used for figuring out
+ * the alignment that <code>malloc</code> guarantees.
+ */
+union _vec2_max_align
+{
+    long        l;
+    double      d;
+    long double ld;
+    void       *p;
+    void      (*fp)(void);
+};
+
+/**
+ * Header of a memory block from which an arena carves its allocations.
+ */
+struct _vec2_arena_block
+{
+    struct _vec2_arena_block *next;
+    size_t                    size;
+    size_t                    used;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+static unsigned char *_vec2_default_align_block(unsigned char *mem, size_t align)
+{
+    /* The block is at least size_t aligned and align is greater than that, so there's always
+     * room to store the offset of the aligned block right before it */
+    unsigned char *ptr = mem + (align - ((size_t)mem % align));
+    size_t offset = (size_t)(ptr - mem);
+
+    memcpy(ptr - sizeof(offset), &offset, sizeof(offset));
+    return ptr;
+}
+
+static size_t _vec2_default_block_offset(void *ptr)
+{
+    size_t offset = 0;
+
+    memcpy(&offset, (unsigned char *)ptr - sizeof(offset), sizeof(offset));
+    return offset;
+}
+
+static void *_vec2_default_allocate(void *ctx, size_t size, size_t align)
+{
+    unsigned char *mem = NULL;
+
+    (void)ctx;
+
+    if (align <= VEC2_MAX_ALIGN)
+    {
+        return malloc(size);
+    }
+
+    /* Over-allocate so that there's enough room to align the block */
+    if ((size > (size_t)-1 - align) || ((mem = (unsigned char *)malloc(size + align)) == NULL))
+    {
+        return NULL;
+    }
+
+    return _vec2_default_align_block(mem, align);
+}
+
+static void *_vec2_default_allocate_zeroed(void *ctx, size_t size, size_t align)
+{
+    void *ptr = NULL;
+
+    (void)ctx;
+
+    /* Let calloc get zeroed pages from the kernel where it can */
+    if (align <= VEC2_MAX_ALIGN)
+    {
+        return calloc(size, 1);
+    }
+
+    if ((ptr = _vec2_default_allocate(NULL, size, align)) != NULL)
+    {
+        memset(ptr, 0, size);
+    }
+
+    return ptr;
+}
+
+static void *_vec2_default_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+    unsigned char *new_mem = NULL, *new_ptr = NULL;
+    size_t offset;
+
+    (void)ctx;
+
+    if (align <= VEC2_MAX_ALIGN)
+    {
+        return realloc(ptr, new_size);
+    }
+
+    offset = _vec2_default_block_offset(ptr);
+
+    /* Keep using realloc for the underlying block, so that in-place growth is still possible */
+    if ((new_size > (size_t)-1 - align) ||
+        ((new_mem = (unsigned char *)realloc((unsigned char *)ptr - offset, new_size + align)) == NULL))
+    {
+        return NULL;
+    }
+
+    new_ptr = new_mem + (align - ((size_t)new_mem % align));
+
+    /* The block might have moved to an address with a different alignment */
+    if ((size_t)(new_ptr - new_mem) != offset)
+    {
+        memmove(new_ptr, new_mem + offset, (old_size < new_size) ? old_size : new_size);
+    }
+
+    return _vec2_default_align_block(new_mem, align);
+}
+
+static void _vec2_default_deallocate(void *ctx, void *ptr, size_t size, size_t align)
+{
+    (void)ctx;
+    (void)size;
+
+    free((align <= VEC2_MAX_ALIGN) ? ptr : (unsigned char *)ptr - _vec2_default_block_offset(ptr));
+}
+
+/**
+ * The allocator used by vectors that weren't given one explicitly.
+ */
+static const struct vec2_allocator _vec2_default_allocator =
+{
+    NULL,
+    _vec2_default_allocate,
+    _vec2_default_reallocate,
+    _vec2_default_deallocate,
+    _vec2_default_allocate_zeroed
+};
+
+/**
+ * The growth policy used by vectors that weren't given one explicitly.
+ */
+static const struct vec2_growth _vec2_default_growth = VEC2_GROWTH_GEOMETRIC(VEC2_INITIAL_CAPACITY, 3, 2);
+
+static struct _vec2_arena_block *_vec2_arena_new_block(struct vec2_arena *arena_ptr, size_t size)
+{
+    struct _vec2_arena_block *block = NULL;
+
+    if (size < arena_ptr->_block_size)
+    {
+        size = arena_ptr->_block_size;
+    }
+
+    /* Avoid integer overflow */
+    if (size > (size_t)-1 - VEC2_ARENA_HEADER_SIZE)
+    {
+        return NULL;
+    }
+
+    block = (struct _vec2_arena_block *)malloc(VEC2_ARENA_HEADER_SIZE + size);
+
+    if (block != NULL)
+    {
+        block->next = arena_ptr->_blocks;
+        block->size = size;
+        block->used = 0;
+        arena_ptr->_blocks = block;
+    }
+
+    return block;
+}
+
+static void *_vec2_arena_allocate(void *ctx, size_t size, size_t align)
+{
+    struct vec2_arena *arena_ptr = (struct vec2_arena *)ctx;
+    struct _vec2_arena_block *block = arena_ptr->_blocks;
+    size_t padding = 0, aligned_size = VEC2_ROUND_UP(size, VEC2_MAX_ALIGN);
+    unsigned char *ptr = NULL;
+
+    if (align < VEC2_MAX_ALIGN)
+    {
+        align = VEC2_MAX_ALIGN;
+    }
+
+    /* Avoid integer overflow */
+    if ((aligned_size < size) || (aligned_size > (size_t)-1 - align))
+    {
+        return NULL;
+    }
+
+    if (block != NULL)
+    {
+        padding = VEC2_ARENA_PADDING(block, align);
+    }
+
+    /* Start a new block if there's not enough room left in the current one */
+    if ((block == NULL) || (block->size - block->used < padding) ||
+        (block->size - block->used - padding < aligned_size))
+    {
+        if ((block = _vec2_arena_new_block(arena_ptr, aligned_size + (align - VEC2_MAX_ALIGN))) == NULL)
+        {
+            return NULL;
+        }
+
+        padding = VEC2_ARENA_PADDING(block, align);
+    }
+
+    ptr = VEC2_ARENA_MEM(block) + block->used + padding;
+    block->used += padding + aligned_size;
+    arena_ptr->_last = ptr;
+
+    return ptr;
+}
+
+static void *_vec2_arena_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+    struct vec2_arena *arena_ptr = (struct vec2_arena *)ctx;
+    void *new_ptr = NULL;
+
+    /* The last allocation can be resized in place as long as it still fits in its block */
+    if (ptr == arena_ptr->_last)
+    {
+        struct _vec2_arena_block *block = arena_ptr->_blocks;
+        size_t offset = (size_t)((unsigned char *)ptr - VEC2_ARENA_MEM(block));
+        size_t aligned_size = VEC2_ROUND_UP(new_size, VEC2_MAX_ALIGN);
+
+        if ((aligned_size >= new_size) && (aligned_size <= block->size - offset))
+        {
+            block->used = offset + aligned_size;
+            return ptr;
+        }
+    }
+    /* Other allocations can't give memory back, so just keep using them when shrinking */
+    else if (new_size <= old_size)
+    {
+        return ptr;
+    }
+
+    new_ptr = _vec2_arena_allocate(ctx, new_size, align);
+
+    if (new_ptr != NULL)
+    {
+        memcpy(new_ptr, ptr, (old_size < new_size) ? old_size : new_size);
+    }
+
+    return new_ptr;
+}
+
+static void _vec2_arena_deallocate(void *ctx, void *ptr, size_t size, size_t align)
+{
+    struct vec2_arena *arena_ptr = (struct vec2_arena *)ctx;
+
+    (void)size;
+    (void)align;
+
+    /* Only the last allocation can be returned to the arena. The rest is released on reset */
+    if (ptr == arena_ptr->_last)
+    {
+        arena_ptr->_blocks->used = (size_t)((unsigned char *)ptr - VEC2_ARENA_MEM(arena_ptr->_blocks));
+        arena_ptr->_last = NULL;
+    }
+}
+
+#ifdef VEC2_HAVE_MREMAP
+static size_t _vec2_mmap_length(const struct vec2_mmap *mmap_ptr, size_t size)
+{
+    /* The huge page threshold can change while buffers are mapped, so the length of a mapping
+     * must only depend on its size. Huge pages only need the mapping to be aligned to them */
+    return VEC2_ROUND_UP(size, mmap_ptr->_page_size);
+}
+
+static unsigned char *_vec2_mmap_map_aligned(const struct vec2_mmap *mmap_ptr, size_t length, size_t alignment)
+{
+    size_t head, slack = alignment - mmap_ptr->_page_size;
+    unsigned char *ptr = (unsigned char *)mmap(NULL, length + slack, PROT_READ | PROT_WRITE,
+                                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ptr == (unsigned char *)MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    /* Trim the excess on both sides of the aligned part of the mapping */
+    head = VEC2_ROUND_UP((size_t)ptr, alignment) - (size_t)ptr;
+
+    if (head > 0)
+    {
+        munmap(ptr, head);
+    }
+
+    if (slack > head)
+    {
+        munmap(ptr + head + length, slack - head);
+    }
+
+    return ptr + head;
+}
+
+static void _vec2_mmap_advise_huge(unsigned char *ptr, size_t length)
+{
+#ifdef MADV_HUGEPAGE
+    /* This is just a hint, so it's fine if it fails (e.g. THP is disabled) */
+    (void)madvise(ptr, length, MADV_HUGEPAGE);
+#else
+    (void)ptr;
+    (void)length;
+#endif /* MADV_HUGEPAGE */
+}
+
+static size_t _vec2_mmap_alignment(const struct vec2_mmap *mmap_ptr, size_t size, size_t align)
+{
+    size_t alignment = vec2_mmap_huge(mmap_ptr, size) ? VEC2_HUGE_PAGE_SIZE : mmap_ptr->_page_size;
+
+    return (align > alignment) ? align : alignment;
+}
+
+static void *_vec2_mmap_map(const struct vec2_mmap *mmap_ptr, size_t size, size_t align)
+{
+    size_t length = _vec2_mmap_length(mmap_ptr, size);
+    unsigned char *ptr = _vec2_mmap_map_aligned(mmap_ptr, length, _vec2_mmap_alignment(mmap_ptr, size, align));
+
+    if ((ptr != NULL) && vec2_mmap_huge(mmap_ptr, size))
+    {
+        _vec2_mmap_advise_huge(ptr, length);
+    }
+
+    return ptr;
+}
+
+static void *_vec2_mmap_remap(const struct vec2_mmap *mmap_ptr, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+    size_t old_length = _vec2_mmap_length(mmap_ptr, old_size);
+    size_t new_length = _vec2_mmap_length(mmap_ptr, new_size);
+    size_t alignment = _vec2_mmap_alignment(mmap_ptr, new_size, align);
+    unsigned char *new_ptr = (unsigned char *)ptr;
+
+    if (old_length == new_length)
+    {
+        /* Nothing to remap */
+    }
+    else if ((new_length < old_length) || (alignment == mmap_ptr->_page_size))
+    {
+        /* Let the kernel move the pages around instead of copying them. Shrinking is
+         * always done in place, which keeps the alignment intact */
+        new_ptr = (unsigned char *)mremap(ptr, old_length, new_length, MREMAP_MAYMOVE);
+    }
+    else
+    {
+        unsigned char *target = NULL;
+
+        /* Extending in place is the cheapest option, but only keeps the alignment if
+         * the mapping is already aligned */
+        new_ptr = ((size_t)ptr % alignment) ? (unsigned char *)MAP_FAILED :
+            (unsigned char *)mremap(ptr, old_length, new_length, 0);
+
+        /* Otherwise move the pages to a fresh aligned address range */
+        if ((new_ptr == (unsigned char *)MAP_FAILED) &&
+            ((target = _vec2_mmap_map_aligned(mmap_ptr, new_length, alignment)) != NULL))
+        {
+            new_ptr = (unsigned char *)mremap(ptr, old_length, new_length,
+                                              MREMAP_MAYMOVE | MREMAP_FIXED, target);
+
+            if (new_ptr == (unsigned char *)MAP_FAILED)
+            {
+                munmap(target, new_length);
+            }
+        }
+
+        /* As a last resort, give up on huge page alignment (but never on the required one) */
+        if ((new_ptr == (unsigned char *)MAP_FAILED) && (align <= mmap_ptr->_page_size))
+        {
+            new_ptr = (unsigned char *)mremap(ptr, old_length, new_length, MREMAP_MAYMOVE);
+        }
+
+        if ((new_ptr != (unsigned char *)MAP_FAILED) && vec2_mmap_huge(mmap_ptr, new_size))
+        {
+            _vec2_mmap_advise_huge(new_ptr, new_length);
+        }
+    }
+
+    return (new_ptr == (unsigned char *)MAP_FAILED) ? NULL : new_ptr;
+}
+#endif /* VEC2_HAVE_MREMAP */
+
+static void *_vec2_mmap_allocate(void *ctx, size_t size, size_t align)
+{
+    struct vec2_mmap *mmap_ptr = (struct vec2_mmap *)ctx;
+
+#ifdef VEC2_HAVE_MREMAP
+    if (size >= mmap_ptr->_threshold)
+    {
+        /* Avoid integer overflow when rounding up to whole pages */
+        return (size <= VEC2_MMAP_MAX_SIZE) ? _vec2_mmap_map(mmap_ptr, size, align) : NULL;
+    }
+#else
+    (void)mmap_ptr;
+#endif /* VEC2_HAVE_MREMAP */
+
+    return _vec2_default_allocate(NULL, size, align);
+}
+
+static void *_vec2_mmap_allocate_zeroed(void *ctx, size_t size, size_t align)
+{
+    struct vec2_mmap *mmap_ptr = (struct vec2_mmap *)ctx;
+
+#ifdef VEC2_HAVE_MREMAP
+    /* Freshly mapped pages are always zeroed */
+    if (size >= mmap_ptr->_threshold)
+    {
+        return _vec2_mmap_allocate(ctx, size, align);
+    }
+#else
+    (void)mmap_ptr;
+#endif /* VEC2_HAVE_MREMAP */
+
+    return _vec2_default_allocate_zeroed(NULL, size, align);
+}
+
+static void *_vec2_mmap_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+    struct vec2_mmap *mmap_ptr = (struct vec2_mmap *)ctx;
+
+#ifdef VEC2_HAVE_MREMAP
+    if ((old_size >= mmap_ptr->_threshold) || (new_size >= mmap_ptr->_threshold))
+    {
+        void *new_ptr = NULL;
+
+        /* Avoid integer overflow when rounding up to whole pages */
+        if (new_size > VEC2_MMAP_MAX_SIZE)
+        {
+            return NULL;
+        }
+
+        if (old_size < mmap_ptr->_threshold)
+        {
+            /* Moving from the heap to a mapping */
+            if ((new_ptr = _vec2_mmap_map(mmap_ptr, new_size, align)) != NULL)
+            {
+                memcpy(new_ptr, ptr, old_size);
+                _vec2_default_deallocate(NULL, ptr, old_size, align);
+            }
+        }
+        else if (new_size < mmap_ptr->_threshold)
+        {
+            /* Moving from a mapping back to the heap */
+            if ((new_ptr = _vec2_default_allocate(NULL, new_size, align)) != NULL)
+            {
+                memcpy(new_ptr, ptr, new_size);
+                munmap(ptr, _vec2_mmap_length(mmap_ptr, old_size));
+            }
+        }
+        else
+        {
+            new_ptr = _vec2_mmap_remap(mmap_ptr, ptr, old_size, new_size, align);
+        }
+
+        return new_ptr;
+    }
+#else
+    (void)mmap_ptr;
+#endif /* VEC2_HAVE_MREMAP */
+
+    return _vec2_default_reallocate(NULL, ptr, old_size, new_size, align);
+}
+
+static void _vec2_mmap_deallocate(void *ctx, void *ptr, size_t size, size_t align)
+{
+    struct vec2_mmap *mmap_ptr = (struct vec2_mmap *)ctx;
+
+#ifdef VEC2_HAVE_MREMAP
+    if (size >= mmap_ptr->_threshold)
+    {
+        munmap(ptr, _vec2_mmap_length(mmap_ptr, size));
+        return;
+    }
+#else
+    (void)mmap_ptr;
+#endif /* VEC2_HAVE_MREMAP */
+
+    _vec2_default_deallocate(NULL, ptr, size, align);
+}
+
+static size_t _vec2_cache_class(size_t size, size_t align)
+{
+    size_t class_idx = 0;
+    size_t class_size = VEC2_CACHE_MIN_SIZE;
+
+    /* Buffers that are too big or over-aligned go straight to the backing allocator */
+    if ((size > VEC2_CACHE_MAX_SIZE) || (align > VEC2_MAX_ALIGN))
+    {
+        return _VEC2_IMPL_CACHE_CLASSES;
+    }
+
+    while (class_size < size)
+    {
+        class_size <<= 1;
+        ++class_idx;
+    }
+
+    return class_idx;
+}
+
+static void *_vec2_cache_allocate(void *ctx, size_t size, size_t align)
+{
+    struct vec2_cache *cache_ptr = (struct vec2_cache *)ctx;
+    const struct vec2_allocator *backing = vec2_cache_backing(cache_ptr);
+    size_t class_idx = _vec2_cache_class(size, align);
+    void *ptr = NULL;
+
+    if (class_idx == _VEC2_IMPL_CACHE_CLASSES)
+    {
+        return backing->allocate(backing->ctx, size, align);
+    }
+
+    if ((ptr = cache_ptr->_bins[class_idx]) != NULL)
+    {
+        /* Pop the buffer off its bin. The next buffer is linked from its first bytes */
+        memcpy(&cache_ptr->_bins[class_idx], ptr, sizeof(ptr));
+        cache_ptr->_bytes -= VEC2_CACHE_MIN_SIZE << class_idx;
+        ++cache_ptr->_hits;
+
+        return ptr;
+    }
+
+    /* Allocate the whole size class, so that the buffer can be reused for any size in it */
+    ++cache_ptr->_misses;
+    return backing->allocate(backing->ctx, VEC2_CACHE_MIN_SIZE << class_idx, VEC2_MAX_ALIGN);
+}
+
+static void _vec2_cache_deallocate(void *ctx, void *ptr, size_t size, size_t align)
+{
+    struct vec2_cache *cache_ptr = (struct vec2_cache *)ctx;
+    const struct vec2_allocator *backing = vec2_cache_backing(cache_ptr);
+    size_t class_idx = _vec2_cache_class(size, align);
+    size_t class_size = VEC2_CACHE_MIN_SIZE << class_idx;
+
+    if (class_idx == _VEC2_IMPL_CACHE_CLASSES)
+    {
+        backing->deallocate(backing->ctx, ptr, size, align);
+    }
+    else if (class_size > cache_ptr->_limit - cache_ptr->_bytes)
+    {
+        /* The cache is full */
+        backing->deallocate(backing->ctx, ptr, class_size, VEC2_MAX_ALIGN);
+    }
+    else
+    {
+        memcpy(ptr, &cache_ptr->_bins[class_idx], sizeof(ptr));
+        cache_ptr->_bins[class_idx] = ptr;
+        cache_ptr->_bytes += class_size;
+    }
+}
+
+static void *_vec2_cache_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+    struct vec2_cache *cache_ptr = (struct vec2_cache *)ctx;
+    const struct vec2_allocator *backing = vec2_cache_backing(cache_ptr);
+    size_t old_class = _vec2_cache_class(old_size, align);
+    size_t new_class = _vec2_cache_class(new_size, align);
+    void *new_ptr = NULL;
+
+    if ((old_class == _VEC2_IMPL_CACHE_CLASSES) && (new_class == _VEC2_IMPL_CACHE_CLASSES))
+    {
+        return backing->reallocate(backing->ctx, ptr, old_size, new_size, align);
+    }
+
+    /* The buffer already spans its whole size class */
+    if (old_class == new_class)
+    {
+        return ptr;
+    }
+
+    if ((new_ptr = _vec2_cache_allocate(ctx, new_size, align)) != NULL)
+    {
+        memcpy(new_ptr, ptr, (old_size < new_size) ? old_size : new_size);
+        _vec2_cache_deallocate(ctx, ptr, old_size, align);
+    }
+
+    return new_ptr;
+}
+
+#ifdef VEC2_THREAD_LOCAL
+/**
+ * The buffer cache of the current thread. Zeroed until the thread first uses it.
+ */
+static VEC2_THREAD_LOCAL struct vec2_cache _vec2_thread_cache_instance;
+
+static struct vec2_cache *_vec2_thread_cache_get(void)
+{
+    if (_vec2_thread_cache_instance._allocator.allocate == NULL)
+    {
+        vec2_cache_init(&_vec2_thread_cache_instance, NULL, 0);
+    }
+
+    return &_vec2_thread_cache_instance;
+}
+
+/* The thread cache allocator ignores its context and always works with the cache of the
+ * current thread, so that vectors can be cleared on a thread other than the one that
+ * allocated their buffer */
+static void *_vec2_thread_cache_allocate(void *ctx, size_t size, size_t align)
+{
+    (void)ctx;
+    return _vec2_cache_allocate(_vec2_thread_cache_get(), size, align);
+}
+
+static void *_vec2_thread_cache_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+    (void)ctx;
+    return _vec2_cache_reallocate(_vec2_thread_cache_get(), ptr, old_size, new_size, align);
+}
+
+static void _vec2_thread_cache_deallocate(void *ctx, void *ptr, size_t size, size_t align)
+{
+    (void)ctx;
+    _vec2_cache_deallocate(_vec2_thread_cache_get(), ptr, size, align);
+}
+
+/**
+ * The allocator that vectors use in order to allocate from the cache of the current thread.
+ */
+static const struct vec2_allocator _vec2_thread_cache_allocator =
+{
+    NULL,
+    _vec2_thread_cache_allocate,
+    _vec2_thread_cache_reallocate,
+    _vec2_thread_cache_deallocate,
+    NULL
+};
+#endif /* VEC2_THREAD_LOCAL */
+
+static size_t _vec2_start_granularity(const struct _vec2_impl_struct *vec_ptr, size_t el_size)
+{
+    /* The lowest set bit of the element size is the largest power of two that divides it */
+    size_t el_align = el_size & (~el_size + 1);
+
+    /* The start offset must be a multiple of this amount of elements for the data to stay aligned */
+    return (el_align >= vec2_align(vec_ptr)) ? 1 : vec2_align(vec_ptr) / el_align;
+}
+
+static void _vec2_advance_start(struct _vec2_impl_struct *vec_ptr, size_t len, size_t el_size)
+{
+    unsigned char *mem = vec2_mem(vec_ptr, el_size);
+    size_t new_start = vec2_start(vec_ptr) + len;
+    size_t aligned_start = new_start - (new_start % _vec2_start_granularity(vec_ptr, el_size));
+
+    /* Move the remaining elements back a bit if advancing all the way would misalign them */
+    if (aligned_start != new_start)
+    {
+        memmove(mem + (aligned_start * el_size), mem + (new_start * el_size), vec2_size(vec_ptr) * el_size);
+    }
+
+    vec2_start(vec_ptr) = aligned_start;
+    vec_ptr->data = mem + (aligned_start * el_size);
+}
+
+static int _vec2_resize_buffer(struct _vec2_impl_struct *vec_ptr, size_t new_capacity, size_t el_size)
+{
+    unsigned char *new_mem = NULL;
+    size_t alloc_size = new_capacity * el_size;
+
+    /* Avoid integer overflow */
+    if (alloc_size / el_size != new_capacity)
+    {
+        return FALSE;
+    }
+
+    if (vec2_borrowed(vec_ptr))
+    {
+        /* A borrowed buffer is never resized, so there's nothing to do when shrinking */
+        if (new_capacity <= vec2_capacity(vec_ptr))
+        {
+            return TRUE;
+        }
+
+        /* A fixed capacity vector must never allocate */
+        if (vec_ptr->_flags & _VEC2_IMPL_FLAG_FIXED)
+        {
+            return FALSE;
+        }
+
+        /* Spill over to a buffer of our own, keeping the elements at the same offset */
+        new_mem = (unsigned char *)vec2_alloc(vec_ptr)->allocate(vec2_alloc(vec_ptr)->ctx,
+            alloc_size, vec2_align(vec_ptr));
+
+        if (new_mem != NULL)
+        {
+            memcpy(new_mem + (el_size * vec2_start(vec_ptr)), vec2_data(vec_ptr), el_size * vec2_size(vec_ptr));
+            vec_ptr->_flags &= ~_VEC2_IMPL_FLAG_BORROWED;
+        }
+    }
+    else if (vec2_data(vec_ptr) == NULL)
+    {
+        new_mem = (unsigned char *)vec2_alloc(vec_ptr)->allocate(vec2_alloc(vec_ptr)->ctx,
+            alloc_size, vec2_align(vec_ptr));
+    }
+    else
+    {
+        new_mem = (unsigned char *)vec2_alloc(vec_ptr)->reallocate(vec2_alloc(vec_ptr)->ctx,
+            vec2_mem(vec_ptr, el_size), vec2_capacity(vec_ptr) * el_size, alloc_size, vec2_align(vec_ptr));
+    }
+
+    /* Check if allocation succeeded */
+    if (new_mem == NULL)
+    {
+        return FALSE;
+    }
+
+    /* Set the new values */
+    vec_ptr->data = new_mem + (el_size * vec2_start(vec_ptr));
+    vec_ptr->capacity = new_capacity;
+
+    return TRUE;
+}
+
+static int _vec2_replace_zeroed(struct _vec2_impl_struct *vec_ptr, size_t new_capacity, size_t el_size)
+{
+    const struct vec2_allocator *alloc = vec2_alloc(vec_ptr);
+    unsigned char *new_mem = NULL;
+    size_t alloc_size = new_capacity * el_size;
+
+    /* Avoid integer overflow */
+    if (alloc_size / el_size != new_capacity)
+    {
+        return FALSE;
+    }
+
+    if (alloc->allocate_zeroed != NULL)
+    {
+        new_mem = (unsigned char *)alloc->allocate_zeroed(alloc->ctx, alloc_size, vec2_align(vec_ptr));
+    }
+    else if ((new_mem = (unsigned char *)alloc->allocate(alloc->ctx, alloc_size, vec2_align(vec_ptr))) != NULL)
+    {
+        memset(new_mem, 0, alloc_size);
+    }
+
+    if (new_mem == NULL)
+    {
+        return FALSE;
+    }
+
+    /* The contents of the current buffer don't matter, so there's no point in reallocating it */
+    if (vec2_data(vec_ptr) != NULL)
+    {
+        alloc->deallocate(alloc->ctx, vec2_mem(vec_ptr, el_size), vec2_capacity(vec_ptr) * el_size, vec2_align(vec_ptr));
+    }
+
+    vec_ptr->data = new_mem;
+    vec_ptr->capacity = new_capacity;
+    vec2_start(vec_ptr) = 0;
+
+    return TRUE;
+}
+
+static int _vec2_reserve(struct _vec2_impl_struct *vec_ptr, size_t additional, size_t el_size)
+{
+    /* Check if we need to do anything */
+    if (additional > vec2_capacity(vec_ptr) - vec2_size(vec_ptr))
+    {
+        size_t new_capacity = vec2_capacity(vec_ptr) + additional;
+
+        /* Avoid integer overflow */
+        if (new_capacity < vec2_capacity(vec_ptr))
+        {
+            return FALSE;
+        }
+
+        return _vec2_resize_buffer(vec_ptr, new_capacity, el_size);
+    }
+
+    return TRUE;
+}
+
+static int _vec2_create_hole(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, size_t el_size)
+{
+    /* Don't allow adding elements in arbitrary place that is beyond vec2_size(vec_ptr)
+     * and avoid integer overflow */
+    if ((len <= 0) || (idx > vec2_size(vec_ptr)) ||
+        (vec2_size(vec_ptr) + len < vec2_size(vec_ptr)))
+    {
+        return FALSE;
+    }
+
+    /* Check if we need to reserve more memory */
+    if (vec2_size(vec_ptr) + len > vec2_capacity(vec_ptr))
+    {
+        const struct vec2_growth *growth = vec2_growth(vec_ptr);
+        size_t required = vec2_size(vec_ptr) + len;
+        size_t new_capacity = growth->next_capacity(growth, vec2_capacity(vec_ptr), required, el_size);
+
+        /* Fall back to growing by exactly what's required if the policy's suggestion
+         * is not enough or can't be satisfied */
+        if (((new_capacity < required) || !_vec2_resize_buffer(vec_ptr, new_capacity, el_size)) &&
+            !_vec2_resize_buffer(vec_ptr, required, el_size))
+        {
+            return FALSE;
+        }
+    }
+
+    /* Perform all sorts of crazy calculations only if we already have some elements that
+     * we might need to move around. */
+    if (vec2_size(vec_ptr) > 0)
+    {
+        size_t granularity = _vec2_start_granularity(vec_ptr, el_size);
+
+        /* Check if we can create free slot at idx with simple pointer regression */
+        if ((idx == 0) && (vec2_start(vec_ptr) >= len) && ((vec2_start(vec_ptr) - len) % granularity == 0))
+        {
+            vec2_start(vec_ptr) -= len;
+            vec_ptr->data -= len * el_size;
+        }
+        /* Otherwise, unlss we're required to shove the new elements at the end and we have
+         * enough space there, we now need to shuffle things around */
+        else if ((idx < vec2_size(vec_ptr)) ||
+                 (len > (vec2_capacity(vec_ptr) - (vec2_start(vec_ptr) + vec2_size(vec_ptr)))))
+        {
+            /* If creating a hole at the end, assume that the pattern is end insertion and just
+             * shift everything to the beginning to make room */
+            size_t shift_back = (idx == vec2_size(vec_ptr)) || (len > vec2_start(vec_ptr)) ?
+                vec2_start(vec_ptr) : len;
+
+            /* Shift all the way back if shifting by len would misalign the data */
+            if ((vec2_start(vec_ptr) - shift_back) % granularity)
+            {
+                shift_back = vec2_start(vec_ptr);
+            }
+
+            vec2_start(vec_ptr) -= shift_back;
+            vec_ptr->data -= shift_back * el_size;
+
+            memmove(vec2_data(vec_ptr), VEC2_GET(vec_ptr, el_size, shift_back), idx * el_size);
+
+            /* Shift the rest of the elements to their place after the hole if shifting back
+             * didn't leave exactly enough room for it */
+            if ((idx < vec2_size(vec_ptr)) && (len != shift_back))
+            {
+                memmove(VEC2_GET(vec_ptr, el_size, idx + len),
+                        VEC2_GET(vec_ptr, el_size, idx + shift_back),
+                        (vec2_size(vec_ptr) - idx) * el_size);
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static int _vec2_remove(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, size_t el_size, void *opt_out_val)
+{
+    /* Make sure that the index is reachable */
+    if ((len > vec2_size(vec_ptr)) || (vec2_size(vec_ptr) - len < idx))
+    {
+        return FALSE;
+    }
+
+    /* Check if we actually need to do anything */
+    if (len)
+    {
+        /* Check if we need to copy out the values that are being removed */
+        if (opt_out_val)
+        {
+            memcpy(opt_out_val, VEC2_GET(vec_ptr, el_size, idx), len * el_size);
+        }
+
+        vec_ptr->size -= len;
+
+        /* Rewind to the beginning of the buffer once empty, so that the next insertion can't
+         * run past its end */
+        if (vec2_size(vec_ptr) == 0)
+        {
+            vec_ptr->data = vec2_mem(vec_ptr, el_size);
+            vec2_start(vec_ptr) = 0;
+        }
+        /* Check if we need to shift elements around because of the removal */
+        else
+        {
+            /* Check if we can get it done with a simple start pointer advancement */
+            if (idx == 0)
+            {
+                _vec2_advance_start(vec_ptr, len, el_size);
+            }
+            else if (idx < vec2_size(vec_ptr))
+            {
+                /* Shift back len slots from `idx + len` to `idx` */
+                memmove(VEC2_GET(vec_ptr, el_size, idx),
+                        VEC2_GET(vec_ptr, el_size, idx + len),
+                        (vec2_size(vec_ptr) - idx) * el_size);
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static int _vec2_buffers_compatible(const struct _vec2_impl_struct *first, const struct _vec2_impl_struct *second)
+{
+    /* Buffers can only change hands between vecs that would have allocated them the same way */
+    return (vec2_alloc(first) == vec2_alloc(second)) && (vec2_align(first) == vec2_align(second)) &&
+        !vec2_borrowed(first) && !vec2_borrowed(second);
+}
+
+static void _vec2_swap_buffers(struct _vec2_impl_struct *first, struct _vec2_impl_struct *second)
+{
+    struct _vec2_impl_struct tmp;
+
+    tmp.size = first->size;
+    tmp.capacity = first->capacity;
+    tmp._start = first->_start;
+    tmp.data = first->data;
+
+    first->size = second->size;
+    first->capacity = second->capacity;
+    first->_start = second->_start;
+    first->data = second->data;
+
+    second->size = tmp.size;
+    second->capacity = tmp.capacity;
+    second->_start = tmp._start;
+    second->data = tmp.data;
+}
+
+static void _vec2_reset(struct _vec2_impl_struct *vec_ptr)
+{
+    const struct vec2_allocator *alloc = vec_ptr->_alloc;
+    const struct vec2_growth *growth = vec_ptr->_growth;
+    unsigned int flags = vec_ptr->_flags & ~(_VEC2_IMPL_FLAG_BORROWED | _VEC2_IMPL_FLAG_FIXED);
+
+    /* The allocator, the growth policy, and the alignment are properties of the vector
+     * rather than of its buffer, so keep them */
+    memset(vec_ptr, 0, sizeof(struct _vec2_impl_struct));
+    vec_ptr->_alloc = alloc;
+    vec_ptr->_growth = growth;
+    vec_ptr->_flags = flags;
+}
+
+static void _vec2_swap_bytes(unsigned char *first, unsigned char *second, size_t len)
+{
+    union
+    {
+        size_t align_dummy;
+        unsigned char bytes[VEC2_SWAP_SIZE];
+    } swap;
+
+    for (; len >= sizeof(swap.bytes); len -= sizeof(swap.bytes))
+    {
+        memcpy(swap.bytes, first, sizeof(swap.bytes));
+        memcpy(first, second, sizeof(swap.bytes));
+        memcpy(second, swap.bytes, sizeof(swap.bytes));
+        first += sizeof(swap.bytes);
+        second += sizeof(swap.bytes);
+    }
+
+    if (len)
+    {
+        memcpy(swap.bytes, first, len);
+        memcpy(first, second, len);
+        memcpy(second, swap.bytes, len);
+    }
+}
+
+static void _vec2_reverse(unsigned char *first, size_t len, size_t el_size)
+{
+    unsigned char *last;
+
+    if (len < 2)
+    {
+        return;
+    }
+
+    last = first + ((len - 1) * el_size);
+
+    switch (el_size)
+    {
+    case 1:
+        VEC2_REVERSE_FIXED(first, last, 1);
+        break;
+    case 2:
+        VEC2_REVERSE_FIXED(first, last, 2);
+        break;
+    case 4:
+        VEC2_REVERSE_FIXED(first, last, 4);
+        break;
+    case 8:
+        VEC2_REVERSE_FIXED(first, last, 8);
+        break;
+    case 16:
+        VEC2_REVERSE_FIXED(first, last, 16);
+        break;
+    default:
+        for (; first < last; first += el_size, last -= el_size)
+        {
+            _vec2_swap_bytes(first, last, el_size);
+        }
+        break;
+    }
+}
+
+static unsigned char *_vec2_radix_sort(unsigned char *src, unsigned char *dst, size_t len, size_t el_size,
+    int kind, size_t key_offset, size_t key_size)
+{
+    static const unsigned int endianness_probe = 1;
+    int little_endian = *(const unsigned char *)&endianness_probe;
+    size_t counts[VEC2_RADIX_MAX_KEY_SIZE][256];
+    size_t msb_off = key_offset + (little_endian ? key_size - 1 : 0);
+    size_t digit_idx, i, off;
+    unsigned int top_mask;
+    int flip_negative = (kind == VEC2_KEY_FLOAT);
+    const unsigned char *el;
+    unsigned char *tmp;
+
+    /* Count all the digits in a single pass */
+    memset(counts, 0, key_size * sizeof(counts[0]));
+    for (el = src; el < src + (len * el_size); el += el_size)
+    {
+        for (digit_idx = 0; digit_idx < key_size; ++digit_idx)
+        {
+            off = key_offset + (little_endian ? digit_idx : key_size - 1 - digit_idx);
+            top_mask = ((digit_idx == key_size - 1) && (kind != VEC2_KEY_UNSIGNED)) ? 0x80 : 0;
+            ++counts[digit_idx][VEC2_RADIX_DIGIT(el)];
+        }
+    }
+
+    /* Scatter the elements by each digit, from the least significant one */
+    for (digit_idx = 0; digit_idx < key_size; ++digit_idx)
+    {
+        size_t *count = counts[digit_idx], sum = 0;
+
+        off = key_offset + (little_endian ? digit_idx : key_size - 1 - digit_idx);
+        top_mask = ((digit_idx == key_size - 1) && (kind != VEC2_KEY_UNSIGNED)) ? 0x80 : 0;
+
+        /* Skip digits that are the same for all the elements */
+        if (count[VEC2_RADIX_DIGIT(src)] == len)
+        {
+            continue;
+        }
+
+        for (i = 0; i < 256; ++i)
+        {
+            size_t bucket_len = count[i];
+            count[i] = sum;
+            sum += bucket_len;
+        }
+
+        switch (el_size)
+        {
+        case 4:
+            VEC2_RADIX_SCATTER(src, dst, len, 4, VEC2_RADIX_DIGIT);
+            break;
+        case 8:
+            VEC2_RADIX_SCATTER(src, dst, len, 8, VEC2_RADIX_DIGIT);
+            break;
+        case 16:
+            VEC2_RADIX_SCATTER(src, dst, len, 16, VEC2_RADIX_DIGIT);
+            break;
+        default:
+            VEC2_RADIX_SCATTER(src, dst, len, el_size, VEC2_RADIX_DIGIT);
+            break;
+        }
+
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+
+    /* The sorted elements are in whichever buffer was scattered into last */
+    return src;
+}
+
+/* Pending runs of a stable sort, and the buffer used for merging them */
+struct _vec2_stable_sort
+{
+    unsigned char               *data;
+    size_t                       len;
+    size_t                       el_size;
+    _vec2_impl_cmpfn             cmpfn;
+    struct _vec2_impl_struct    *scratch_ptr;
+    unsigned char               *buf;
+    size_t                       run_count;
+    size_t                       run_start[VEC2_SORT_MAX_RUNS];
+    size_t                       run_len[VEC2_SORT_MAX_RUNS];
+};
+
+static size_t _vec2_bound(const unsigned char *base, size_t len, const void *key, size_t el_size,
+    _vec2_impl_cmpfn cmpfn, int upper)
+{
+    size_t low = 0, high = len;
+
+    /* Find the first element that is not less than the key (or that is greater than the key) */
+    while (low < high)
+    {
+        size_t mid = low + ((high - low) / 2);
+        int cmp = cmpfn(base + (mid * el_size), key);
+
+        if ((cmp < 0) || (upper && (cmp == 0)))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static unsigned char *_vec2_stable_sort_buf(struct _vec2_stable_sort *sort)
+{
+    /* Merging never needs room for more than half the elements */
+    size_t buf_len = (sort->len / 2) + 1;
+
+    if (sort->buf == NULL)
+    {
+        if (sort->scratch_ptr != NULL)
+        {
+            if (_vec2_reserve(sort->scratch_ptr, buf_len, sort->el_size))
+            {
+                sort->buf = vec2_data(sort->scratch_ptr);
+            }
+        }
+        else
+        {
+            sort->buf = (unsigned char *)_vec2_default_allocate(NULL, buf_len * sort->el_size, VEC2_MAX_ALIGN);
+        }
+    }
+
+    return sort->buf;
+}
+
+static int _vec2_insertion_sort(struct _vec2_stable_sort *sort, unsigned char *base, size_t len, size_t sorted_len)
+{
+    union
+    {
+        size_t align_dummy;
+        unsigned char bytes[VEC2_SORT_TMP_SIZE];
+    } tmp_buf;
+    size_t el_size = sort->el_size;
+    unsigned char *tmp = tmp_buf.bytes;
+    size_t i, pos;
+
+    if ((el_size > sizeof(tmp_buf.bytes)) && ((tmp = _vec2_stable_sort_buf(sort)) == NULL))
+    {
+        return FALSE;
+    }
+
+    /* Insert after equal elements to keep the sort stable */
+    for (i = sorted_len; i < len; ++i)
+    {
+        pos = _vec2_bound(base, i, base + (i * el_size), el_size, sort->cmpfn, TRUE);
+
+        if (pos < i)
+        {
+            memcpy(tmp, base + (i * el_size), el_size);
+            memmove(base + ((pos + 1) * el_size), base + (pos * el_size), (i - pos) * el_size);
+            memcpy(base + (pos * el_size), tmp, el_size);
+        }
+    }
+
+    return TRUE;
+}
+
+static size_t _vec2_count_run(const struct _vec2_stable_sort *sort, unsigned char *base, size_t len)
+{
+    size_t el_size = sort->el_size;
+    size_t run_len = 2;
+
+    if (len < 2)
+    {
+        return len;
+    }
+
+    /* Only strictly descending runs can be reversed without breaking stability */
+    if (sort->cmpfn(base + el_size, base) < 0)
+    {
+        while ((run_len < len) && (sort->cmpfn(base + (run_len * el_size), base + ((run_len - 1) * el_size)) < 0))
+        {
+            ++run_len;
+        }
+
+        _vec2_reverse(base, run_len, el_size);
+    }
+    else
+    {
+        while ((run_len < len) && (sort->cmpfn(base + (run_len * el_size), base + ((run_len - 1) * el_size)) >= 0))
+        {
+            ++run_len;
+        }
+    }
+
+    return run_len;
+}
+
+static int _vec2_merge_runs(struct _vec2_stable_sort *sort, size_t run_idx)
+{
+    size_t el_size = sort->el_size;
+    unsigned char *first = sort->data + (sort->run_start[run_idx] * el_size);
+    unsigned char *second = sort->data + (sort->run_start[run_idx + 1] * el_size);
+    size_t first_len = sort->run_len[run_idx];
+    size_t second_len = sort->run_len[run_idx + 1];
+    size_t skip_len, i;
+    unsigned char *buf, *buf_end, *second_end, *dst;
+
+    sort->run_len[run_idx] += second_len;
+
+    for (i = run_idx + 1; i + 1 < sort->run_count; ++i)
+    {
+        sort->run_start[i] = sort->run_start[i + 1];
+        sort->run_len[i] = sort->run_len[i + 1];
+    }
+
+    --sort->run_count;
+
+    /* Elements of the first run that aren't greater than the beginning of the second one, and elements
+     * of the second run that aren't less than the end of the first one, are already in place */
+    skip_len = _vec2_bound(first, first_len, second, el_size, sort->cmpfn, TRUE);
+    first += skip_len * el_size;
+    first_len -= skip_len;
+
+    if (first_len == 0)
+    {
+        return TRUE;
+    }
+
+    second_len = _vec2_bound(second, second_len, second - el_size, el_size, sort->cmpfn, FALSE);
+
+    if (second_len == 0)
+    {
+        return TRUE;
+    }
+
+    if ((buf = _vec2_stable_sort_buf(sort)) == NULL)
+    {
+        return FALSE;
+    }
+
+    /* Move the shorter run out of the way, and merge from the side it was on. Ties are broken in
+     * favor of the first run */
+    if (first_len <= second_len)
+    {
+        memcpy(buf, first, first_len * el_size);
+        buf_end = buf + (first_len * el_size);
+        second_end = second + (second_len * el_size);
+        dst = first;
+
+        for (; (buf < buf_end) && (second < second_end); dst += el_size)
+        {
+            if (sort->cmpfn(second, buf) < 0)
+            {
+                memcpy(dst, second, el_size);
+                second += el_size;
+            }
+            else
+            {
+                memcpy(dst, buf, el_size);
+                buf += el_size;
+            }
+        }
+
+        memcpy(dst, buf, (size_t)(buf_end - buf));
+    }
+    else
+    {
+        memcpy(buf, second, second_len * el_size);
+        buf_end = buf + (second_len * el_size);
+        dst = second + (second_len * el_size);
+        second = first + (first_len * el_size);
+
+        while ((buf_end > buf) && (second > first))
+        {
+            dst -= el_size;
+
+            if (sort->cmpfn(buf_end - el_size, second - el_size) < 0)
+            {
+                second -= el_size;
+                memcpy(dst, second, el_size);
+            }
+            else
+            {
+                buf_end -= el_size;
+                memcpy(dst, buf_end, el_size);
+            }
+        }
+
+        memcpy(first, buf, (size_t)(buf_end - buf));
+    }
+
+    return TRUE;
+}
+
+static int _vec2_merge_collapse(struct _vec2_stable_sort *sort, int force)
+{
+    /* Keep the pending run lengths decreasing at least as fast as the Fibonacci numbers (which bounds
+     * their number) so that merges stay balanced, or merge all of them when forced */
+    while (sort->run_count > 1)
+    {
+        size_t idx = sort->run_count - 2;
+        size_t *len = sort->run_len;
+
+        if (force ||
+            ((idx > 0) && (len[idx - 1] <= len[idx] + len[idx + 1])) ||
+            ((idx > 1) && (len[idx - 2] <= len[idx - 1] + len[idx])))
+        {
+            if ((idx > 0) && (len[idx - 1] < len[idx + 1]))
+            {
+                --idx;
+            }
+        }
+        else if (len[idx] > len[idx + 1])
+        {
+            break;
+        }
+
+        if (!_vec2_merge_runs(sort, idx))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static int _vec2_stable_sort(struct _vec2_stable_sort *sort)
+{
+    size_t min_run = 0, pos = 0, run_len, len;
+
+    /* Pick a minimal run length in [32, 64] that splits the elements to a power of two runs or a
+     * bit less than that */
+    for (len = sort->len; len >= 64; len >>= 1)
+    {
+        min_run |= len & 1;
+    }
+
+    min_run += len;
+
+    while (pos < sort->len)
+    {
+        unsigned char *base = sort->data + (pos * sort->el_size);
+
+        run_len = _vec2_count_run(sort, base, sort->len - pos);
+
+        /* Extend short runs using insertion sort */
+        if (run_len < min_run)
+        {
+            size_t forced_len = (sort->len - pos < min_run) ? sort->len - pos : min_run;
+
+            if (!_vec2_insertion_sort(sort, base, forced_len, run_len))
+            {
+                return FALSE;
+            }
+
+            run_len = forced_len;
+        }
+
+        sort->run_start[sort->run_count] = pos;
+        sort->run_len[sort->run_count] = run_len;
+        ++sort->run_count;
+        pos += run_len;
+
+        if (!_vec2_merge_collapse(sort, FALSE))
+        {
+            return FALSE;
+        }
+    }
+
+    return _vec2_merge_collapse(sort, TRUE);
+}
+
+#ifdef VEC2_HAVE_PTHREADS
+/* A part of a parallel sort: either sorting a chunk in place, or producing a part of the merge of
+ * two adjacent sorted runs */
+struct _vec2_sort_task
+{
+    const unsigned char *src;
+    unsigned char       *dst;
+    size_t               first_len;
+    size_t               second_len;
+    size_t               out_begin;
+    size_t               out_end;
+    size_t               el_size;
+    _vec2_impl_cmpfn     cmpfn;
+};
+
+static size_t _vec2_merge_split(const struct _vec2_sort_task *task, size_t out_idx)
+{
+    const unsigned char *first = task->src;
+    const unsigned char *second = task->src + (task->first_len * task->el_size);
+    size_t low = (out_idx > task->second_len) ? out_idx - task->second_len : 0;
+    size_t high = (out_idx < task->first_len) ? out_idx : task->first_len;
+
+    /* Find how many of the first out_idx merged elements come from the first run, which is the least
+     * amount that doesn't leave an element from the first run behind one from the second run */
+    while (low < high)
+    {
+        size_t first_idx = low + ((high - low) / 2);
+
+        if (task->cmpfn(second + ((out_idx - first_idx - 1) * task->el_size),
+                        first + (first_idx * task->el_size)) >= 0)
+        {
+            low = first_idx + 1;
+        }
+        else
+        {
+            high = first_idx;
+        }
+    }
+
+    return low;
+}
+
+static void *_vec2_sort_task_run(void *arg)
+{
+    const struct _vec2_sort_task *task = (const struct _vec2_sort_task *)arg;
+    const unsigned char *first, *first_end, *second, *second_end;
+    unsigned char *out, *out_end;
+    size_t first_idx;
+
+    if (task->src == NULL)
+    {
+        qsort(task->dst, task->first_len, task->el_size, task->cmpfn);
+        return NULL;
+    }
+
+    first_idx = _vec2_merge_split(task, task->out_begin);
+    first = task->src + (first_idx * task->el_size);
+    second = task->src + ((task->first_len + task->out_begin - first_idx) * task->el_size);
+
+    first_idx = _vec2_merge_split(task, task->out_end);
+    first_end = task->src + (first_idx * task->el_size);
+    second_end = task->src + ((task->first_len + task->out_end - first_idx) * task->el_size);
+
+    out = task->dst + (task->out_begin * task->el_size);
+    out_end = task->dst + (task->out_end * task->el_size);
+
+    /* Take from the first run on ties, so that merging is stable */
+    while ((first < first_end) && (second < second_end))
+    {
+        if (task->cmpfn(second, first) < 0)
+        {
+            memcpy(out, second, task->el_size);
+            second += task->el_size;
+        }
+        else
+        {
+            memcpy(out, first, task->el_size);
+            first += task->el_size;
+        }
+
+        out += task->el_size;
+    }
+
+    memcpy(out, first, (size_t)(first_end - first));
+    memcpy(out + (first_end - first), second, (size_t)(out_end - out) - (size_t)(first_end - first));
+
+    return NULL;
+}
+
+static void _vec2_run_sort_tasks(struct _vec2_sort_task *tasks, size_t count)
+{
+    pthread_t threads[VEC2_SORT_MAX_THREADS];
+    int started[VEC2_SORT_MAX_THREADS];
+    size_t i;
+
+    for (i = 1; i < count; ++i)
+    {
+        started[i] = (pthread_create(&threads[i], NULL, _vec2_sort_task_run, &tasks[i]) == 0);
+    }
+
+    /* The calling thread does its share of the work too, along with the work of any thread that
+     * failed to start */
+    _vec2_sort_task_run(&tasks[0]);
+
+    for (i = 1; i < count; ++i)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+        else
+        {
+            _vec2_sort_task_run(&tasks[i]);
+        }
+    }
+}
+
+static void _vec2_parallel_sort(unsigned char *data, unsigned char *scratch, size_t len, size_t el_size,
+    _vec2_impl_cmpfn cmpfn, size_t thread_count)
+{
+    struct _vec2_sort_task tasks[VEC2_SORT_MAX_THREADS];
+    size_t bounds[VEC2_SORT_MAX_THREADS + 1];
+    unsigned char *src = data, *dst = scratch, *tmp;
+    size_t runs = thread_count, i;
+
+    /* Sort equal chunks, one per thread */
+    for (i = 0; i <= runs; ++i)
+    {
+        bounds[i] = ((len / runs) * i) + (((len % runs) * i) / runs);
+    }
+
+    for (i = 0; i < runs; ++i)
+    {
+        tasks[i].src = NULL;
+        tasks[i].dst = data + (bounds[i] * el_size);
+        tasks[i].first_len = bounds[i + 1] - bounds[i];
+        tasks[i].el_size = el_size;
+        tasks[i].cmpfn = cmpfn;
+    }
+
+    _vec2_run_sort_tasks(tasks, runs);
+
+    /* Merge pairs of adjacent runs until there's a single one left. Every merge is split into parts of
+     * equal size, so that all the threads keep working even when there are fewer pairs than threads */
+    while (runs > 1)
+    {
+        size_t pairs = (runs + 1) / 2;
+        size_t parts = (thread_count / pairs) ? thread_count / pairs : 1;
+        size_t task_count = 0, pair, part;
+
+        for (pair = 0; pair < pairs; ++pair)
+        {
+            size_t begin = bounds[2 * pair];
+            size_t mid = bounds[(2 * pair) + 1];
+            size_t end = ((2 * pair) + 2 <= runs) ? bounds[(2 * pair) + 2] : mid;
+
+            for (part = 0; part < parts; ++part)
+            {
+                struct _vec2_sort_task *task = &tasks[task_count++];
+
+                task->src = src + (begin * el_size);
+                task->dst = dst + (begin * el_size);
+                task->first_len = mid - begin;
+                task->second_len = end - mid;
+                task->out_begin = (((end - begin) / parts) * part) + ((((end - begin) % parts) * part) / parts);
+                task->out_end = (((end - begin) / parts) * (part + 1)) +
+                    ((((end - begin) % parts) * (part + 1)) / parts);
+                task->el_size = el_size;
+                task->cmpfn = cmpfn;
+            }
+        }
+
+        _vec2_run_sort_tasks(tasks, task_count);
+
+        for (pair = 0; pair < pairs; ++pair)
+        {
+            bounds[pair] = bounds[2 * pair];
+        }
+
+        bounds[pairs] = len;
+        runs = pairs;
+
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != data)
+    {
+        memcpy(data, src, len * el_size);
+    }
+}
+#endif /* VEC2_HAVE_PTHREADS */
+
+static void _vec2_fill(unsigned char *dst, const void *val, size_t len, size_t el_size)
+{
+    const unsigned char *val_bytes = (const unsigned char *)val;
+    size_t i = 1, filled, total = len * el_size;
+
+    if (len == 0)
+    {
+        return;
+    }
+
+    /* A value made of a single repeated byte (zero being the common case) is a memset */
+    while ((i < el_size) && (val_bytes[i] == val_bytes[0]))
+    {
+        ++i;
+    }
+
+    if (i == el_size)
+    {
+        memset(dst, val_bytes[0], total);
+        return;
+    }
+
+    /* Otherwise, keep doubling the filled prefix until it's a chunk big enough for memcpy to run at
+     * full speed (but small enough to stay in cache), and then keep copying that chunk.
+     * The value is read only once, so it may be anywhere in the filled range */
+    memmove(dst, val, el_size);
+    filled = el_size;
+
+    while ((filled < VEC2_FILL_CHUNK_SIZE) && (filled <= total - filled))
+    {
+        memcpy(dst + filled, dst, filled);
+        filled *= 2;
+    }
+
+    for (i = filled; total - i >= filled; i += filled)
+    {
+        memcpy(dst + i, dst, filled);
+    }
+
+    memcpy(dst + i, dst, total - i);
+}
+
+static void _vec2_swap_remove(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t el_size, void *opt_out_val)
+{
+    size_t last_idx = vec2_size(vec_ptr) - 1;
+
+    if (opt_out_val)
+    {
+        memcpy(opt_out_val, VEC2_GET(vec_ptr, el_size, idx), el_size);
+    }
+
+    /* Removing the first element is a simple start pointer advancement, as long as it
+     * doesn't have to move the rest of the elements to keep them aligned */
+    if ((idx == 0) && (_vec2_start_granularity(vec_ptr, el_size) == 1))
+    {
+        _vec2_remove(vec_ptr, 0, 1, el_size, NULL);
+    }
+    else
+    {
+        /* Fill the hole with the last element */
+        if (idx != last_idx)
+        {
+            memcpy(VEC2_GET(vec_ptr, el_size, idx), VEC2_GET(vec_ptr, el_size, last_idx), el_size);
+        }
+
+        _vec2_remove(vec_ptr, last_idx, 1, el_size, NULL);
+    }
+}
+
+static void _vec2_clear(struct _vec2_impl_struct *vec_ptr, size_t el_size)
+{
+    /* A borrowed buffer isn't ours to free, so just empty it */
+    if (vec2_borrowed(vec_ptr))
+    {
+        vec_ptr->data = vec2_mem(vec_ptr, el_size);
+        vec_ptr->size = 0;
+        vec2_start(vec_ptr) = 0;
+        return;
+    }
+
+    if (vec2_data(vec_ptr) != NULL)
+    {
+        vec2_alloc(vec_ptr)->deallocate(vec2_alloc(vec_ptr)->ctx,
+            vec2_mem(vec_ptr, el_size), vec2_capacity(vec_ptr) * el_size, vec2_align(vec_ptr));
+    }
+
+    _vec2_reset(vec_ptr);
+}
+
+int _vec2_impl_init(struct _vec2_impl_struct *vec_ptr,
+    const struct vec2_allocator *alloc, const struct vec2_growth *growth, size_t alignment)
+{
+    if ((vec_ptr == NULL) ||
+        ((alloc != NULL) &&
+         ((alloc->allocate == NULL) || (alloc->reallocate == NULL) || (alloc->deallocate == NULL))) ||
+        ((growth != NULL) && (growth->next_capacity == NULL)) ||
+        (alignment & (alignment - 1)) || (alignment > VEC2_MAX_ALIGNMENT))
+    {
+        return FALSE;
+    }
+
+    memset(vec_ptr, 0, sizeof(struct _vec2_impl_struct));
+    vec_ptr->_alloc = alloc;
+    vec_ptr->_growth = growth;
+
+    while (alignment > 1)
+    {
+        ++vec_ptr->_flags;
+        alignment >>= 1;
+    }
+
+    return TRUE;
+}
+
+int _vec2_impl_init_buffer(struct _vec2_impl_struct *vec_ptr, void *buf, size_t capacity, int fixed)
+{
+    if ((vec_ptr == NULL) || (buf == NULL) || (capacity == 0))
+    {
+        return FALSE;
+    }
+
+    memset(vec_ptr, 0, sizeof(struct _vec2_impl_struct));
+    vec_ptr->data = (unsigned char *)buf;
+    vec_ptr->capacity = capacity;
+    vec_ptr->_flags = _VEC2_IMPL_FLAG_BORROWED | (fixed ? _VEC2_IMPL_FLAG_FIXED : 0);
+
+    return TRUE;
+}
+
+int _vec2_impl_reserve(struct _vec2_impl_struct *vec_ptr, size_t additional, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || !el_size)
+    {
+        return FALSE;
+    }
+
+    return _vec2_reserve(vec_ptr, additional, el_size);
+}
+
+int _vec2_impl_shrink(struct _vec2_impl_struct *vec_ptr, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || !el_size)
+    {
+        return FALSE;
+    }
+
+    if (vec2_size(vec_ptr) == 0)
+    {
+        _vec2_clear(vec_ptr, el_size);
+    }
+    else if ((vec2_size(vec_ptr) < vec2_capacity(vec_ptr)) &&
+             (vec2_capacity(vec_ptr) > vec2_growth(vec_ptr)->initial))
+    {
+        size_t new_capacity = (vec2_size(vec_ptr) > vec2_growth(vec_ptr)->initial) ?
+            vec2_size(vec_ptr) : vec2_growth(vec_ptr)->initial;
+
+        /* Move the data to the beginning if we're at an offset due to removals.
+         * This might cause double copy if realloc allocates a new buffer for us instead
+         * of shrinking the current one, but we can't just do a malloc and copy because
+         * then we give up the potential of in-place shrinking, and we might run into OOM */
+        if (vec2_start(vec_ptr) > 0)
+        {
+            unsigned char *mem = vec2_mem(vec_ptr, el_size);
+
+            memmove(mem, vec2_data(vec_ptr), el_size * vec2_size(vec_ptr));
+            vec_ptr->data = mem;
+            vec2_start(vec_ptr) = 0;
+        }
+
+        return _vec2_resize_buffer(vec_ptr, new_capacity, el_size);
+    }
+
+    return TRUE;
+}
+
+int _vec2_impl_resize(struct _vec2_impl_struct *vec_ptr, size_t new_size, int zeroed, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || !el_size)
+    {
+        return FALSE;
+    }
+
+    if (new_size <= vec2_size(vec_ptr))
+    {
+        return _vec2_remove(vec_ptr, new_size, vec2_size(vec_ptr) - new_size, el_size, NULL);
+    }
+
+    /* When an empty vec needs a new buffer anyway, get one that's zeroed to begin with */
+    if (zeroed && (vec2_size(vec_ptr) == 0) && (new_size > vec2_capacity(vec_ptr)) && !vec2_borrowed(vec_ptr))
+    {
+        if (!_vec2_replace_zeroed(vec_ptr, new_size, el_size))
+        {
+            return FALSE;
+        }
+    }
+    else
+    {
+        if (!_vec2_create_hole(vec_ptr, vec2_size(vec_ptr), new_size - vec2_size(vec_ptr), el_size))
+        {
+            return FALSE;
+        }
+
+        if (zeroed)
+        {
+            memset(VEC2_GET(vec_ptr, el_size, vec2_size(vec_ptr)), 0, (new_size - vec2_size(vec_ptr)) * el_size);
+        }
+    }
+
+    vec_ptr->size = new_size;
+    return TRUE;
+}
+
+int _vec2_impl_create_hole(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || (len <= 0) || !el_size ||
+        !_vec2_create_hole(vec_ptr, idx, len, el_size))
+    {
+        return FALSE;
+    }
+
+
+    vec_ptr->_idx[0] = idx;
+    return TRUE;
+}
+
+int _vec2_impl_swap(struct _vec2_impl_struct *vec_ptr, size_t first, size_t second, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) ||
+        (first >= vec2_size(vec_ptr)) || (second >= vec2_size(vec_ptr)) || !el_size)
+    {
+        return FALSE;
+    }
+
+    /* Check if we need to do anything */
+    if (first != second)
+    {
+        _vec2_swap_bytes(VEC2_GET(vec_ptr, el_size, first), VEC2_GET(vec_ptr, el_size, second), el_size);
+    }
+
+    return TRUE;
+}
+
+int _vec2_impl_reverse(struct _vec2_impl_struct *vec_ptr, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || !el_size)
+    {
+        return FALSE;
+    }
+
+    _vec2_reverse(vec2_data(vec_ptr), vec2_size(vec_ptr), el_size);
+    return TRUE;
+}
+
+int _vec2_impl_rotate(struct _vec2_impl_struct *vec_ptr, size_t shift, size_t el_size)
+{
+    union
+    {
+        size_t align_dummy;
+        unsigned char bytes[VEC2_ROTATE_BUF_SIZE];
+    } buf;
+    size_t granularity, left_len, right_len;
+    unsigned char *ptr;
+
+    if (!_vec2_impl_valid(vec_ptr) || !el_size)
+    {
+        return FALSE;
+    }
+
+    if (vec2_size(vec_ptr) < 2)
+    {
+        return TRUE;
+    }
+
+    /* The elements before the shift go to the end, the ones after it go to the beginning */
+    left_len = shift % vec2_size(vec_ptr);
+    right_len = vec2_size(vec_ptr) - left_len;
+    granularity = _vec2_start_granularity(vec_ptr, el_size);
+
+    if (left_len == 0)
+    {
+        return TRUE;
+    }
+
+    /* If there's enough free space around the elements, only the shorter side has to be copied
+     * over to the other end, and the start moves along with it */
+    if ((left_len <= right_len) &&
+        (vec2_capacity(vec_ptr) - vec2_start(vec_ptr) - vec2_size(vec_ptr) >= left_len) &&
+        ((vec2_start(vec_ptr) + left_len) % granularity == 0))
+    {
+        memcpy(VEC2_GET(vec_ptr, el_size, vec2_size(vec_ptr)), vec2_data(vec_ptr), left_len * el_size);
+        vec2_start(vec_ptr) += left_len;
+        vec_ptr->data += left_len * el_size;
+    }
+    else if ((right_len <= left_len) && (vec2_start(vec_ptr) >= right_len) &&
+             ((vec2_start(vec_ptr) - right_len) % granularity == 0))
+    {
+        memcpy(vec2_data(vec_ptr) - (right_len * el_size), VEC2_GET(vec_ptr, el_size, left_len), right_len * el_size);
+        vec2_start(vec_ptr) -= right_len;
+        vec_ptr->data -= right_len * el_size;
+    }
+    /* If the shorter side is small, stash it away while moving the other side over */
+    else if (left_len * el_size <= sizeof(buf.bytes))
+    {
+        memcpy(buf.bytes, vec2_data(vec_ptr), left_len * el_size);
+        memmove(vec2_data(vec_ptr), VEC2_GET(vec_ptr, el_size, left_len), right_len * el_size);
+        memcpy(VEC2_GET(vec_ptr, el_size, right_len), buf.bytes, left_len * el_size);
+    }
+    else if (right_len * el_size <= sizeof(buf.bytes))
+    {
+        memcpy(buf.bytes, VEC2_GET(vec_ptr, el_size, left_len), right_len * el_size);
+        memmove(VEC2_GET(vec_ptr, el_size, right_len), vec2_data(vec_ptr), left_len * el_size);
+        memcpy(vec2_data(vec_ptr), buf.bytes, right_len * el_size);
+    }
+    /* Otherwise, swap blocks until the two sides trade places. Each swap puts one side in its final
+     * place, and the swapped blocks are contiguous no matter how big the elements are */
+    else
+    {
+        ptr = vec2_data(vec_ptr);
+        left_len *= el_size;
+        right_len *= el_size;
+
+        while (left_len && right_len)
+        {
+            if (left_len <= right_len)
+            {
+                _vec2_swap_bytes(ptr, ptr + right_len, left_len);
+                right_len -= left_len;
+            }
+            else
+            {
+                _vec2_swap_bytes(ptr, ptr + left_len, right_len);
+                ptr += right_len;
+                left_len -= right_len;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+int _vec2_impl_sort(struct _vec2_impl_struct *vec_ptr, _vec2_impl_cmpfn cmpfn, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || (cmpfn == NULL) || !el_size)
+    {
+        return FALSE;
+    }
+
+    /* Check if we need to sort anything */
+    if (vec2_size(vec_ptr))
+    {
+        qsort(VEC2_GET(vec_ptr, el_size, 0), vec2_size(vec_ptr), el_size, cmpfn);
+    }
+
+    return TRUE;
+}
+
+int _vec2_impl_parallel_sort(struct _vec2_impl_struct *vec_ptr, _vec2_impl_cmpfn cmpfn, size_t thread_count,
+    size_t el_size)
+{
+#ifdef VEC2_HAVE_PTHREADS
+    unsigned char *scratch;
+    size_t len;
+
+    if (!_vec2_impl_valid(vec_ptr) || (cmpfn == NULL) || !el_size)
+    {
+        return FALSE;
+    }
+
+    len = vec2_size(vec_ptr);
+
+    if (thread_count == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = (online > 0) ? (size_t)online : 1;
+    }
+
+    /* Don't bother with threads unless each one gets a decent amount of work */
+    if (thread_count > VEC2_SORT_MAX_THREADS)
+    {
+        thread_count = VEC2_SORT_MAX_THREADS;
+    }
+
+    if (thread_count > len / VEC2_SORT_MIN_CHUNK)
+    {
+        thread_count = len / VEC2_SORT_MIN_CHUNK;
+    }
+
+    if ((thread_count > 1) && (len <= (size_t)-1 / el_size))
+    {
+        scratch = (unsigned char *)_vec2_default_allocate(NULL, len * el_size, VEC2_MAX_ALIGN);
+
+        if (scratch != NULL)
+        {
+            _vec2_parallel_sort(vec2_data(vec_ptr), scratch, len, el_size, cmpfn, thread_count);
+            _vec2_default_deallocate(NULL, scratch, len * el_size, VEC2_MAX_ALIGN);
+            return TRUE;
+        }
+    }
+#else
+    (void)thread_count;
+#endif /* VEC2_HAVE_PTHREADS */
+
+    /* Sort on the calling thread if there's no point in using more threads, or if it's not possible */
+    return _vec2_impl_sort(vec_ptr, cmpfn, el_size);
+}
+
+int _vec2_impl_stable_sort(struct _vec2_impl_struct *vec_ptr, _vec2_impl_cmpfn cmpfn,
+    struct _vec2_impl_struct *scratch_ptr, size_t el_size)
+{
+    struct _vec2_stable_sort sort;
+    int result;
+
+    if (!_vec2_impl_valid(vec_ptr) || (cmpfn == NULL) || !el_size ||
+        ((scratch_ptr != NULL) && (!_vec2_impl_valid(scratch_ptr) || (scratch_ptr == vec_ptr))))
+    {
+        return FALSE;
+    }
+
+    sort.data = vec2_data(vec_ptr);
+    sort.len = vec2_size(vec_ptr);
+    sort.el_size = el_size;
+    sort.cmpfn = cmpfn;
+    sort.scratch_ptr = scratch_ptr;
+    sort.buf = NULL;
+    sort.run_count = 0;
+
+    if ((sort.len / 2) + 1 > (size_t)-1 / el_size)
+    {
+        return FALSE;
+    }
+
+    /* The scratch vec only lends its buffer, so it's left empty */
+    if (scratch_ptr != NULL)
+    {
+        _vec2_remove(scratch_ptr, 0, vec2_size(scratch_ptr), el_size, NULL);
+    }
+
+    result = _vec2_stable_sort(&sort);
+
+    if ((scratch_ptr == NULL) && (sort.buf != NULL))
+    {
+        _vec2_default_deallocate(NULL, sort.buf, ((sort.len / 2) + 1) * el_size, VEC2_MAX_ALIGN);
+    }
+
+    return result;
+}
+
+int _vec2_impl_radix_sort(struct _vec2_impl_struct *vec_ptr, int kind, size_t key_offset, size_t key_size,
+    struct _vec2_impl_struct *scratch_ptr, size_t el_size)
+{
+    unsigned char *scratch, *sorted;
+    size_t len;
+
+    if (!_vec2_impl_valid(vec_ptr) || !el_size || (key_size == 0) || (key_size > VEC2_RADIX_MAX_KEY_SIZE) ||
+        (key_offset > el_size) || (el_size - key_offset < key_size) ||
+        ((kind != VEC2_KEY_UNSIGNED) && (kind != VEC2_KEY_SIGNED) && (kind != VEC2_KEY_FLOAT)) ||
+        ((kind == VEC2_KEY_FLOAT) && (key_size != sizeof(float)) && (key_size != sizeof(double))) ||
+        ((scratch_ptr != NULL) && (!_vec2_impl_valid(scratch_ptr) || (scratch_ptr == vec_ptr))))
+    {
+        return FALSE;
+    }
+
+    len = vec2_size(vec_ptr);
+
+    /* Check if we need to sort anything */
+    if (len < 2)
+    {
+        return TRUE;
+    }
+
+    /* Get room for a copy of the elements, preferably from the scratch vec. Its contents are only
+     * dropped once it's known to be big enough, so that it's left intact on failure */
+    if (scratch_ptr != NULL)
+    {
+        if ((vec2_capacity(scratch_ptr) < len) &&
+            !_vec2_reserve(scratch_ptr, len - vec2_size(scratch_ptr), el_size))
+        {
+            return FALSE;
+        }
+
+        _vec2_remove(scratch_ptr, 0, vec2_size(scratch_ptr), el_size, NULL);
+        scratch = vec2_data(scratch_ptr);
+    }
+    else
+    {
+        if (len > (size_t)-1 / el_size)
+        {
+            return FALSE;
+        }
+
+        scratch = (unsigned char *)_vec2_default_allocate(NULL, len * el_size, VEC2_MAX_ALIGN);
+        if (scratch == NULL)
+        {
+            return FALSE;
+        }
+    }
+
+    sorted = _vec2_radix_sort(vec2_data(vec_ptr), scratch, len, el_size, kind, key_offset, key_size);
+
+    if (sorted == scratch)
+    {
+        /* Trade buffers with the scratch vec instead of copying the elements back, if possible */
+        if ((scratch_ptr != NULL) && _vec2_buffers_compatible(vec_ptr, scratch_ptr))
+        {
+            scratch_ptr->size = len;
+            _vec2_swap_buffers(vec_ptr, scratch_ptr);
+            _vec2_remove(scratch_ptr, 0, len, el_size, NULL);
+        }
+        else
+        {
+            memcpy(vec2_data(vec_ptr), scratch, len * el_size);
+        }
+    }
+
+    if (scratch_ptr == NULL)
+    {
+        _vec2_default_deallocate(NULL, scratch, len * el_size, VEC2_MAX_ALIGN);
+    }
+
+    return TRUE;
+}
+
+size_t _vec2_impl_bound(struct _vec2_impl_struct *vec_ptr, const void *key, _vec2_impl_cmpfn cmpfn, int upper,
+    size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || (key == NULL) || (cmpfn == NULL) || !el_size)
+    {
+        return 0;
+    }
+
+    return _vec2_bound(vec2_data(vec_ptr), vec2_size(vec_ptr), key, el_size, cmpfn, upper);
+}
+
+int _vec2_impl_equal_range(struct _vec2_impl_struct *vec_ptr, const void *key, _vec2_impl_cmpfn cmpfn,
+    size_t *first_out, size_t *last_out, size_t el_size)
+{
+    const unsigned char *base;
+    size_t low = 0, high;
+
+    if (!_vec2_impl_valid(vec_ptr) || (key == NULL) || (cmpfn == NULL) || !el_size)
+    {
+        return FALSE;
+    }
+
+    base = vec2_data(vec_ptr);
+    high = vec2_size(vec_ptr);
+
+    /* Narrow down the range until it's split by an equal element, and then look for each end of the
+     * equal elements on its side */
+    while (low < high)
+    {
+        size_t mid = low + ((high - low) / 2);
+        int cmp = cmpfn(base + (mid * el_size), key);
+
+        if (cmp < 0)
+        {
+            low = mid + 1;
+        }
+        else if (cmp > 0)
+        {
+            high = mid;
+        }
+        else
+        {
+            low += _vec2_bound(base + (low * el_size), mid - low, key, el_size, cmpfn, FALSE);
+            high = mid + 1 + _vec2_bound(base + ((mid + 1) * el_size), high - mid - 1, key, el_size, cmpfn, TRUE);
+            break;
+        }
+    }
+
+    if (first_out != NULL)
+    {
+        *first_out = low;
+    }
+
+    if (last_out != NULL)
+    {
+        *last_out = high;
+    }
+
+    return TRUE;
+}
+
+int _vec2_impl_eytzinger_build(struct _vec2_impl_struct *dst_ptr, const struct _vec2_impl_struct *src_ptr,
+    size_t el_size)
+{
+    size_t len, i, node = 1;
+
+    if (!_vec2_impl_valid(dst_ptr) || !_vec2_impl_valid(src_ptr) || (dst_ptr == src_ptr) || !el_size)
+    {
+        return FALSE;
+    }
+
+    len = vec2_size(src_ptr);
+    _vec2_remove(dst_ptr, 0, vec2_size(dst_ptr), el_size, NULL);
+
+    if (!_vec2_reserve(dst_ptr, len, el_size))
+    {
+        return FALSE;
+    }
+
+    /* Visit the nodes of the implicit tree (where node k, counting from 1, has the children 2k and
+     * 2k + 1) in order, starting from the leftmost one, and give them the elements in order */
+    while (node <= len / 2)
+    {
+        node *= 2;
+    }
+
+    for (i = 0; i < len; ++i)
+    {
+        memcpy(VEC2_GET(dst_ptr, el_size, node - 1), VEC2_GET(src_ptr, el_size, i), el_size);
+
+        if (node <= (len - 1) / 2)
+        {
+            /* The next node is the leftmost one in the right subtree */
+            node = (2 * node) + 1;
+
+            while (node <= len / 2)
+            {
+                node *= 2;
+            }
+        }
+        else
+        {
+            /* The next node is the first ancestor whose left subtree this node is in */
+            while (node & 1)
+            {
+                node >>= 1;
+            }
+
+            node >>= 1;
+        }
+    }
+
+    dst_ptr->size = len;
+    return TRUE;
+}
+
+size_t _vec2_impl_eytzinger_search(struct _vec2_impl_struct *vec_ptr, const void *key, _vec2_impl_cmpfn cmpfn,
+    size_t el_size)
+{
+    const unsigned char *base;
+    size_t len, span, node = 1;
+
+    if (!_vec2_impl_valid(vec_ptr) || (key == NULL) || (cmpfn == NULL) || !el_size)
+    {
+        return 0;
+    }
+
+    base = vec2_data(vec_ptr);
+    len = vec2_size(vec_ptr);
+    span = _vec2_impl_prefetch_span(el_size);
+
+    while (node <= len)
+    {
+        if (node <= len / span)
+        {
+            _vec2_impl_prefetch(base + (((node * span) - 1) * el_size));
+        }
+
+        node = (2 * node) + ((cmpfn(base + ((node - 1) * el_size), key) < 0) ? 1 : 0);
+    }
+
+    node = _vec2_impl_eytzinger_node(node);
+    return node ? node - 1 : len;
+}
+
+int _vec2_impl_assign(struct _vec2_impl_struct *vec_ptr, size_t idx, const void *val, size_t len, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || (val == NULL) || !el_size ||
+        (idx >= vec2_size(vec_ptr)) || (vec2_size(vec_ptr) - idx < len))
+    {
+        return FALSE;
+    }
+
+    memmove(VEC2_GET(vec_ptr, el_size, idx), val, len * el_size);
+    return TRUE;
+}
+
+int _vec2_impl_fill(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, const void *val, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || (val == NULL) || !el_size ||
+        (idx > vec2_size(vec_ptr)) || (vec2_size(vec_ptr) - idx < len))
+    {
+        return FALSE;
+    }
+
+    _vec2_fill(VEC2_GET(vec_ptr, el_size, idx), val, len, el_size);
+    return TRUE;
+}
+
+int _vec2_impl_push_repeat(struct _vec2_impl_struct *vec_ptr, const void *val, size_t len, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || (val == NULL) || !el_size)
+    {
+        return FALSE;
+    }
+
+    if (len > 0)
+    {
+        if (!_vec2_create_hole(vec_ptr, vec2_size(vec_ptr), len, el_size))
+        {
+            return FALSE;
+        }
+
+        _vec2_fill(VEC2_GET(vec_ptr, el_size, vec2_size(vec_ptr)), val, len, el_size);
+        vec_ptr->size += len;
+    }
+
+    return TRUE;
+}
+
+int _vec2_impl_remove(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, size_t el_size, void *out)
+{
+    if (!_vec2_impl_valid(vec_ptr) || !el_size)
+    {
+        return FALSE;
+    }
+
+    return _vec2_remove(vec_ptr, idx, len, el_size, out);
+}
+
+int _vec2_impl_swap_remove(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t el_size, void *out)
+{
+    if (!_vec2_impl_valid(vec_ptr) || !el_size || (idx >= vec2_size(vec_ptr)))
+    {
+        return FALSE;
+    }
+
+    _vec2_swap_remove(vec_ptr, idx, el_size, out);
+    return TRUE;
+}
+
+int _vec2_impl_swap_remove_indices(struct _vec2_impl_struct *vec_ptr, const size_t *idx_arr, size_t count,
+    size_t el_size, void *out)
+{
+    size_t i;
+
+    if (!_vec2_impl_valid(vec_ptr) || !el_size || ((idx_arr == NULL) && count))
+    {
+        return FALSE;
+    }
+
+    /* The indices must be in strictly ascending order and inside the bounds */
+    for (i = 0; i < count; ++i)
+    {
+        if ((idx_arr[i] >= vec2_size(vec_ptr)) || ((i > 0) && (idx_arr[i] <= idx_arr[i - 1])))
+        {
+            return FALSE;
+        }
+    }
+
+    /* Going from the highest index down means that the last element is never one that's about to
+     * be removed, and that the elements at the lower indices haven't been moved yet */
+    for (i = count; i > 0; --i)
+    {
+        _vec2_swap_remove(vec_ptr, idx_arr[i - 1], el_size,
+            out ? (unsigned char *)out + ((i - 1) * el_size) : NULL);
+    }
+
+    return TRUE;
+}
+
+int _vec2_impl_remove_indices(struct _vec2_impl_struct *vec_ptr, const size_t *idx_arr, size_t count,
+    size_t el_size, void *out)
+{
+    size_t i, skipped, write_idx;
+
+    if (!_vec2_impl_valid(vec_ptr) || !el_size || ((idx_arr == NULL) && count))
+    {
+        return FALSE;
+    }
+
+    /* The indices must be in strictly ascending order and inside the bounds */
+    for (i = 0; i < count; ++i)
+    {
+        if ((idx_arr[i] >= vec2_size(vec_ptr)) || ((i > 0) && (idx_arr[i] <= idx_arr[i - 1])))
+        {
+            return FALSE;
+        }
+    }
+
+    /* Elements removed from the beginning are skipped by advancing the start later on */
+    skipped = 0;
+    while ((skipped < count) && (idx_arr[skipped] == skipped))
+    {
+        ++skipped;
+    }
+
+    if (out && skipped)
+    {
+        memcpy(out, vec2_data(vec_ptr), skipped * el_size);
+    }
+
+    /* Sweep once from the first removed element that isn't part of the skipped prefix, moving each run
+     * of kept elements that follows a removed element into place with a single memmove */
+    write_idx = (skipped < count) ? idx_arr[skipped] : 0;
+    for (i = skipped; i < count; ++i)
+    {
+        size_t run_idx = idx_arr[i] + 1;
+        size_t run_end = (i + 1 < count) ? idx_arr[i + 1] : vec2_size(vec_ptr);
+
+        if (out)
+        {
+            memcpy((unsigned char *)out + (i * el_size), VEC2_GET(vec_ptr, el_size, idx_arr[i]), el_size);
+        }
+
+        if (run_end > run_idx)
+        {
+            memmove(VEC2_GET(vec_ptr, el_size, write_idx), VEC2_GET(vec_ptr, el_size, run_idx),
+                    (run_end - run_idx) * el_size);
+            write_idx += run_end - run_idx;
+        }
+    }
+
+    vec_ptr->size -= count - skipped;
+    _vec2_remove(vec_ptr, 0, skipped, el_size, NULL);
+
+    return TRUE;
+}
+
+int _vec2_impl_insert(struct _vec2_impl_struct *vec_ptr, size_t idx, const void *val, size_t len, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || (val == NULL) || !el_size)
+    {
+        return FALSE;
+    }
+
+    if (len > 0)
+    {
+        if (!_vec2_create_hole(vec_ptr, idx, len, el_size))
+        {
+            return FALSE;
+        }
+
+        /* Copy len elements from val into the free slots */
+        memcpy(VEC2_GET(vec_ptr, el_size, idx), val, el_size * len);
+        vec_ptr->size += len;
+    }
+
+    return TRUE;
+}
+
+int _vec2_impl_splice(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t remove_len, const void *val,
+    size_t insert_len, size_t el_size, void *out)
+{
+    size_t tail_len;
+
+    if (!_vec2_impl_valid(vec_ptr) || ((val == NULL) && insert_len) || !el_size ||
+        (idx > vec2_size(vec_ptr)) || (vec2_size(vec_ptr) - idx < remove_len))
+    {
+        return FALSE;
+    }
+
+    tail_len = vec2_size(vec_ptr) - idx - remove_len;
+
+    /* Grow first, so that failing leaves the vec untouched */
+    if (insert_len > remove_len)
+    {
+        if (!_vec2_create_hole(vec_ptr, idx, insert_len - remove_len, el_size))
+        {
+            return FALSE;
+        }
+
+        /* The removed elements are right after the hole */
+        if (out && remove_len)
+        {
+            memcpy(out, VEC2_GET(vec_ptr, el_size, idx + insert_len - remove_len), remove_len * el_size);
+        }
+
+        vec_ptr->size += insert_len - remove_len;
+    }
+    else
+    {
+        size_t delta = remove_len - insert_len;
+
+        if (out && remove_len)
+        {
+            memcpy(out, VEC2_GET(vec_ptr, el_size, idx), remove_len * el_size);
+        }
+
+        if (delta)
+        {
+            /* Close the gap by moving whichever side of it is shorter, keeping the data aligned */
+            if ((idx < tail_len) && ((vec2_start(vec_ptr) + delta) % _vec2_start_granularity(vec_ptr, el_size) == 0))
+            {
+                memmove(VEC2_GET(vec_ptr, el_size, delta), vec2_data(vec_ptr), idx * el_size);
+                vec2_start(vec_ptr) += delta;
+                vec_ptr->data += delta * el_size;
+                vec_ptr->size -= delta;
+            }
+            else
+            {
+                _vec2_remove(vec_ptr, idx + insert_len, delta, el_size, NULL);
+            }
+        }
+    }
+
+    if (insert_len)
+    {
+        memcpy(VEC2_GET(vec_ptr, el_size, idx), val, insert_len * el_size);
+    }
+
+    return TRUE;
+}
+
+int _vec2_impl_insert_indices(struct _vec2_impl_struct *vec_ptr, const size_t *idx_arr, const void *val,
+    size_t count, size_t el_size)
+{
+    size_t i, end_idx;
+
+    if (!_vec2_impl_valid(vec_ptr) || (((idx_arr == NULL) || (val == NULL)) && count) || !el_size)
+    {
+        return FALSE;
+    }
+
+    /* The indices must be sorted and refer to positions in the vec as it is before the insertion */
+    for (i = 0; i < count; ++i)
+    {
+        if ((idx_arr[i] > vec2_size(vec_ptr)) || ((i > 0) && (idx_arr[i] < idx_arr[i - 1])))
+        {
+            return FALSE;
+        }
+    }
+
+    if ((count == 0) || !_vec2_create_hole(vec_ptr, vec2_size(vec_ptr), count, el_size))
+    {
+        return (count == 0);
+    }
+
+    /* Sweep backwards, moving every run of existing elements straight to its final place (which is
+     * after all the new elements that precede it) and dropping each new element right before it */
+    end_idx = vec2_size(vec_ptr);
+    for (i = count; i > 0; --i)
+    {
+        size_t idx = idx_arr[i - 1];
+
+        if (end_idx > idx)
+        {
+            memmove(VEC2_GET(vec_ptr, el_size, idx + i), VEC2_GET(vec_ptr, el_size, idx), (end_idx - idx) * el_size);
+        }
+
+        memcpy(VEC2_GET(vec_ptr, el_size, idx + i - 1), (const unsigned char *)val + ((i - 1) * el_size), el_size);
+        end_idx = idx;
+    }
+
+    vec_ptr->size += count;
+    return TRUE;
+}
+
+int _vec2_impl_adopt(struct _vec2_impl_struct *vec_ptr, void *buf, size_t size, size_t capacity, size_t el_size)
+{
+    if (!_vec2_impl_valid(vec_ptr) || (buf == NULL) || !el_size ||
+        (capacity == 0) || (size > capacity) || ((size_t)buf % vec2_align(vec_ptr)) ||
+        vec2_buffer_private(vec_ptr))
+    {
+        return FALSE;
+    }
+
+    /* Let go of the current buffer (and of any borrowed buffer) before taking over the new one */
+    if (vec2_borrowed(vec_ptr))
+    {
+        _vec2_reset(vec_ptr);
+    }
+    else
+    {
+        _vec2_clear(vec_ptr, el_size);
+    }
 
-#define VEC2_GET(vec_ptr, el_size, idx) (vec2_data(vec_ptr) + ((idx) * (el_size)))
+    vec_ptr->data = (unsigned char *)buf;
+    vec_ptr->size = size;
+    vec_ptr->capacity = capacity;
 
-#define vec2_start(vec_ptr)             ((vec_ptr)->_start)
-#define vec2_mem(vec_ptr, el_size)      (vec2_data(vec_ptr) - (vec2_start(vec_ptr) * el_size))
+    return TRUE;
+}
 
-/**
- * Definition of the generic vec structure used by the code in this file.
- */
-struct _vec2_impl_struct VEC2_BODY(unsigned char);
+void *_vec2_impl_take(struct _vec2_impl_struct *vec_ptr, size_t *size_out, size_t *capacity_out, size_t el_size)
+{
+    unsigned char *mem = NULL;
+    size_t size, capacity;
 
-#ifdef __cplusplus
-extern "C" {
-#endif /* __cplusplus */
+    if (!_vec2_impl_valid(vec_ptr) || !el_size || (vec2_data(vec_ptr) == NULL) ||
+        (vec_ptr->_flags & _VEC2_IMPL_FLAG_FIXED) || vec2_buffer_private(vec_ptr))
+    {
+        return NULL;
+    }
 
-static int _vec2_reserve(struct _vec2_impl_struct *vec_ptr, size_t additional, size_t el_size)
-{
-    /* Check if we need to do anything */
-    if (additional > vec2_capacity(vec_ptr) - vec2_size(vec_ptr))
+    size = vec2_size(vec_ptr);
+    capacity = vec2_capacity(vec_ptr);
+
+    if (vec2_borrowed(vec_ptr))
     {
-        unsigned char *new_mem = NULL;
-        size_t alloc_size, new_capacity = vec2_capacity(vec_ptr) + additional;
+        /* Inline storage can't be handed over, so the elements have to be copied out of it */
+        capacity = size ? size : 1;
 
-        /* Avoid integer overflow */
-        if (new_capacity < vec2_capacity(vec_ptr))
+        if ((capacity * el_size / el_size != capacity) ||
+            ((mem = (unsigned char *)vec2_alloc(vec_ptr)->allocate(vec2_alloc(vec_ptr)->ctx,
+                capacity * el_size, vec2_align(vec_ptr))) == NULL))
         {
-            return FALSE;
+            return NULL;
         }
 
-        alloc_size = new_capacity * el_size;
+        memcpy(mem, vec2_data(vec_ptr), size * el_size);
+        _vec2_clear(vec_ptr, el_size);
+    }
+    else
+    {
+        /* Make the elements start at the beginning of the buffer */
+        mem = vec2_mem(vec_ptr, el_size);
 
-        /* Avoid integer overflow */
-        if (alloc_size / el_size != new_capacity)
+        if (vec2_start(vec_ptr) > 0)
         {
-            return FALSE;
+            memmove(mem, vec2_data(vec_ptr), size * el_size);
         }
 
-        new_mem = (unsigned char *)realloc(vec2_mem(vec_ptr, el_size), alloc_size);
+        _vec2_reset(vec_ptr);
+    }
+
+    if (size_out)
+    {
+        *size_out = size;
+    }
+
+    if (capacity_out)
+    {
+        *capacity_out = capacity;
+    }
+
+    return mem;
+}
+
+int _vec2_impl_append(struct _vec2_impl_struct *dst_ptr, struct _vec2_impl_struct *src_ptr, size_t el_size)
+{
+    size_t src_size;
+
+    if (!_vec2_impl_valid(dst_ptr) || !_vec2_impl_valid(src_ptr) || (dst_ptr == src_ptr) || !el_size)
+    {
+        return FALSE;
+    }
+
+    src_size = vec2_size(src_ptr);
+
+    if (src_size == 0)
+    {
+        return TRUE;
+    }
+
+    if (_vec2_buffers_compatible(dst_ptr, src_ptr))
+    {
+        /* Steal the source buffer if we have nothing to keep */
+        if (vec2_size(dst_ptr) == 0)
+        {
+            _vec2_swap_buffers(dst_ptr, src_ptr);
+            _vec2_remove(src_ptr, 0, vec2_size(src_ptr), el_size, NULL);
+            return TRUE;
+        }
 
-        /* Check if allocation succeeded */
-        if (new_mem == NULL)
+        /* If there are less elements to keep and they fit in front of the source elements,
+         * copy them there and steal the source buffer */
+        if ((vec2_size(dst_ptr) < src_size) && (vec2_start(src_ptr) >= vec2_size(dst_ptr)) &&
+            ((vec2_start(src_ptr) - vec2_size(dst_ptr)) % _vec2_start_granularity(src_ptr, el_size) == 0))
         {
-            return FALSE;
+            vec2_start(src_ptr) -= vec2_size(dst_ptr);
+            src_ptr->data -= vec2_size(dst_ptr) * el_size;
+            src_ptr->size += vec2_size(dst_ptr);
+            memcpy(vec2_data(src_ptr), vec2_data(dst_ptr), vec2_size(dst_ptr) * el_size);
+
+            _vec2_swap_buffers(dst_ptr, src_ptr);
+            _vec2_remove(src_ptr, 0, vec2_size(src_ptr), el_size, NULL);
+            return TRUE;
         }
+    }
 
-        /* Set the new values */
-        vec_ptr->data = new_mem + (el_size * vec2_start(vec_ptr));
-        vec_ptr->capacity = new_capacity;
+    if (!_vec2_create_hole(dst_ptr, vec2_size(dst_ptr), src_size, el_size))
+    {
+        return FALSE;
     }
 
+    memcpy(VEC2_GET(dst_ptr, el_size, vec2_size(dst_ptr)), vec2_data(src_ptr), src_size * el_size);
+    dst_ptr->size += src_size;
+    _vec2_remove(src_ptr, 0, src_size, el_size, NULL);
+
     return TRUE;
 }
 
-static int _vec2_create_hole(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, size_t el_size)
+int _vec2_impl_retain(struct _vec2_impl_struct *vec_ptr, _vec2_impl_predfn predfn, void *ctx, int keep_matches,
+    struct _vec2_impl_struct *removed_ptr, size_t el_size)
 {
-    /* Don't allow adding elements in arbitrary place that is beyond vec2_size(vec_ptr)
-     * and avoid integer overflow */
-    if ((len <= 0) || (idx > vec2_size(vec_ptr)) ||
-        (vec2_size(vec_ptr) + len < vec2_size(vec_ptr)))
+    size_t size, read_idx = 0, write_idx = 0, run_idx = 0, skipped = 0;
+    int failed = FALSE, keep = FALSE, run_keep;
+
+    if (!_vec2_impl_valid(vec_ptr) || (predfn == NULL) || !el_size ||
+        ((removed_ptr != NULL) && (!_vec2_impl_valid(removed_ptr) || (removed_ptr == vec_ptr))))
     {
         return FALSE;
     }
 
-    /* Check if we need to reserve more memory */
-    if (vec2_size(vec_ptr) + len > vec2_capacity(vec_ptr))
+    size = vec2_size(vec_ptr);
+
+    if (size > 0)
+    {
+        keep = (!predfn(VEC2_GET(vec_ptr, el_size, 0), ctx) == !keep_matches);
+    }
+
+    /* Work in runs, so that each run of kept elements is moved using a single memmove. The predicate
+     * is called exactly once per element, in order, and the result for the element that ends a run
+     * starts the next one */
+    while (read_idx < size)
     {
-        unsigned int addition = vec2_capacity(vec_ptr) ? (vec2_capacity(vec_ptr) >> 1) : VEC2_INITIAL_CAPACITY;
+        run_idx = read_idx;
+        run_keep = keep;
 
-        /* Make sure we reserve enough to store len elements */
-        while (addition < len)
+        do
         {
-            size_t next_addition = (addition << 1) + (addition >> 1);
+            ++read_idx;
+        } while ((read_idx < size) &&
+                 ((keep = (!predfn(VEC2_GET(vec_ptr, el_size, read_idx), ctx) == !keep_matches)) == run_keep));
 
-            if (next_addition < addition)
+        if (run_keep)
+        {
+            if (write_idx != run_idx)
             {
-                addition = len;
-                break;
+                memmove(VEC2_GET(vec_ptr, el_size, write_idx),
+                        VEC2_GET(vec_ptr, el_size, run_idx), (read_idx - run_idx) * el_size);
             }
 
-            addition = next_addition;
+            write_idx += read_idx - run_idx;
         }
-
-        /* Try to reserve place to fit at least len elements */
-        while (!_vec2_reserve(vec_ptr, addition, el_size))
+        else
         {
-            /* Divide by two and try again unless reserve failed even for exactly len elemnts more */
-            if ((addition > len) && ((addition >> 1) < len))
+            if (removed_ptr != NULL)
             {
-                addition = len;
+                if (!_vec2_create_hole(removed_ptr, vec2_size(removed_ptr), read_idx - run_idx, el_size))
+                {
+                    failed = TRUE;
+                    break;
+                }
+
+                memcpy(VEC2_GET(removed_ptr, el_size, vec2_size(removed_ptr)),
+                       VEC2_GET(vec_ptr, el_size, run_idx), (read_idx - run_idx) * el_size);
+                removed_ptr->size += read_idx - run_idx;
             }
-            else if ((addition >>= 1) < len)
+
+            /* Elements removed from the beginning are skipped by advancing the start later on */
+            if (run_idx == 0)
             {
-                return FALSE;
+                skipped = write_idx = read_idx;
             }
         }
     }
 
-    /* Perform all sorts of crazy calculations only if we already have some elements that
-     * we might need to move around. */
-    if (vec2_size(vec_ptr) > 0)
+    /* Keep the elements that weren't processed if we failed to copy out removed elements */
+    if (failed)
     {
-        /* Check if we can create free slot at idx with simple pointer regression */
-        if ((idx == 0) && (vec2_start(vec_ptr) >= len))
+        if (write_idx != run_idx)
         {
-            vec2_start(vec_ptr) -= len;
-            vec_ptr->data -= len * el_size;
+            memmove(VEC2_GET(vec_ptr, el_size, write_idx),
+                    VEC2_GET(vec_ptr, el_size, run_idx), (size - run_idx) * el_size);
         }
-        /* Otherwise, unlss we're required to shove the new elements at the end and we have
-         * enough space there, we now need to shuffle things around */
-        else if ((idx < vec2_size(vec_ptr)) ||
-                 (len > (vec2_capacity(vec_ptr) - (vec2_start(vec_ptr) + vec2_size(vec_ptr)))))
-        {
-            /* If creating a hole at the end, assume that the pattern is end insertion and just
-             * shift everything to the beginning to make room */
-            size_t shift_back = (idx == vec2_size(vec_ptr)) || (len > vec2_start(vec_ptr)) ?
-                vec2_start(vec_ptr) : len;
 
-            vec2_start(vec_ptr) -= shift_back;
-            vec_ptr->data -= shift_back * el_size;
+        write_idx += size - run_idx;
+    }
 
-            memmove(vec2_data(vec_ptr), VEC2_GET(vec_ptr, el_size, shift_back), idx * el_size);
+    vec_ptr->size = write_idx;
+    _vec2_remove(vec_ptr, 0, skipped, el_size, NULL);
 
-            /* Shift elements forward if after shifting back we still need more room */
-            if ((idx < vec2_size(vec_ptr)) && (len > shift_back))
-            {
-                memmove(VEC2_GET(vec_ptr, el_size, idx + len),
-                        VEC2_GET(vec_ptr, el_size, idx + shift_back),
-                        (len - shift_back) * el_size);
-            }
-        }
-    }
+    return !failed;
+}
 
-    return TRUE;
+void _vec2_impl_clear(struct _vec2_impl_struct *vec_ptr, size_t el_size)
+{
+    if (_vec2_impl_valid(vec_ptr))
+    {
+        _vec2_clear(vec_ptr, el_size);
+    }
 }
 
-static int _vec2_remove(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, size_t el_size, void *opt_out_val)
+size_t vec2_growth_geometric(const struct vec2_growth *growth, size_t capacity, size_t required, size_t el_size)
 {
-    /* Make sure that the index is reachable */
-    if ((len > vec2_size(vec_ptr)) || (vec2_size(vec_ptr) - len < idx))
+    size_t new_capacity = capacity ? capacity : growth->initial;
+
+    (void)el_size;
+
+    /* A factor that doesn't grow anything just means growing by what's required */
+    if ((growth->factor_den == 0) || (growth->factor_num <= growth->factor_den))
     {
-        return FALSE;
+        return (new_capacity < required) ? required : new_capacity;
     }
 
-    /* Check if we actually need to do anything */
-    if (len)
+    while (new_capacity < required)
     {
-        /* Check if we need to copy out the values that are being removed */
-        if (opt_out_val)
+        size_t next_capacity;
+
+        /* Avoid integer overflow */
+        if (new_capacity / growth->factor_den > ((size_t)-1 - growth->factor_num) / growth->factor_num)
         {
-            memcpy(opt_out_val, VEC2_GET(vec_ptr, el_size, idx), len * el_size);
+            return required;
         }
 
-        vec_ptr->size -= len;
+        next_capacity = (new_capacity / growth->factor_den) * growth->factor_num +
+            ((new_capacity % growth->factor_den) * growth->factor_num) / growth->factor_den;
 
-        /* Check if we need to shift elements around because of the removal */
-        if (vec2_size(vec_ptr))
-        {
-            /* Check if we can get it done with a simple start pointer advancement */
-            if (idx == 0)
-            {
-                vec2_start(vec_ptr) += len;
-                vec_ptr->data += len * el_size;
-            }
-            else if (idx < vec2_size(vec_ptr))
-            {
-                /* Shift back len slots from `idx + len` to `idx` */
-                memmove(VEC2_GET(vec_ptr, el_size, idx),
-                        VEC2_GET(vec_ptr, el_size, idx + len),
-                        (vec2_size(vec_ptr) - idx) * el_size);
-            }
-        }
+        /* Always make progress, even with tiny capacities */
+        new_capacity = (next_capacity > new_capacity) ? next_capacity : new_capacity + 1;
     }
 
-    return TRUE;
+    return new_capacity;
 }
 
-static void _vec2_clear(struct _vec2_impl_struct *vec_ptr, size_t el_size)
+size_t vec2_growth_paged(const struct vec2_growth *growth, size_t capacity, size_t required, size_t el_size)
 {
-    if (vec2_data(vec_ptr) != NULL)
+    size_t new_capacity = vec2_growth_geometric(growth, capacity, required, el_size);
+    size_t size = new_capacity * el_size;
+    size_t rounded_size = 0;
+
+    /* Avoid integer overflow */
+    if ((growth->step == 0) || (size / el_size != new_capacity) ||
+        ((rounded_size = VEC2_ROUND_UP(size, growth->step)) < size))
     {
-        free(vec2_mem(vec_ptr, el_size));
+        return new_capacity;
     }
 
-    memset(vec_ptr, 0, sizeof(struct _vec2_impl_struct));
+    return rounded_size / el_size;
 }
 
-int _vec2_impl_init(struct _vec2_impl_struct *vec_ptr)
+size_t vec2_growth_chunked(const struct vec2_growth *growth, size_t capacity, size_t required, size_t el_size)
 {
-    if (vec_ptr == NULL)
+    size_t new_capacity = capacity ? capacity : growth->initial;
+    size_t addition;
+
+    (void)el_size;
+
+    if ((growth->step == 0) || (new_capacity >= required))
     {
-        return FALSE;
+        return (new_capacity < required) ? required : new_capacity;
     }
 
-    memset(vec_ptr, 0, sizeof(struct _vec2_impl_struct));
-
-    return TRUE;
-}
+    addition = VEC2_ROUND_UP(required - new_capacity, growth->step);
 
-int _vec2_impl_reserve(struct _vec2_impl_struct *vec_ptr, size_t additional, size_t el_size)
-{
-    if (!_vec2_impl_valid(vec_ptr) || !el_size)
+    /* Avoid integer overflow */
+    if ((addition < required - new_capacity) || (new_capacity + addition < new_capacity))
     {
-        return FALSE;
+        return required;
     }
 
-    return _vec2_reserve(vec_ptr, additional, el_size);
+    return new_capacity + addition;
 }
 
-int _vec2_impl_shrink(struct _vec2_impl_struct *vec_ptr, size_t el_size)
+int vec2_arena_init(struct vec2_arena *arena_ptr, size_t block_size)
 {
-    if (!_vec2_impl_valid(vec_ptr) || !el_size)
+    if (arena_ptr == NULL)
     {
         return FALSE;
     }
 
-    if (vec2_size(vec_ptr) == 0)
-    {
-        _vec2_clear(vec_ptr, el_size);
-    }
-    else if ((vec2_size(vec_ptr) < vec2_capacity(vec_ptr)) &&
-             (vec2_capacity(vec_ptr) > VEC2_INITIAL_CAPACITY))
-    {
-        unsigned char *new_mem = NULL;
-        size_t new_capacity = (vec2_size(vec_ptr) > VEC2_INITIAL_CAPACITY) ? 
-            vec2_size(vec_ptr) : VEC2_INITIAL_CAPACITY;
+    arena_ptr->_allocator.ctx = arena_ptr;
+    arena_ptr->_allocator.allocate = _vec2_arena_allocate;
+    arena_ptr->_allocator.reallocate = _vec2_arena_reallocate;
+    arena_ptr->_allocator.deallocate = _vec2_arena_deallocate;
+    arena_ptr->_allocator.allocate_zeroed = NULL;
+    arena_ptr->_blocks = NULL;
+    arena_ptr->_block_size = block_size ? block_size : VEC2_ARENA_BLOCK_SIZE;
+    arena_ptr->_last = NULL;
 
-        /* Move the data to the beginning if we're at an offset due to removals.
-         * This might cause double copy if realloc allocates a new buffer for us instead
-         * of shrinking the current one, but we can't just do a malloc and copy because
-         * then we give up the potential of in-place shrinking, and we might run into OOM */
-        if (vec2_start(vec_ptr) > 0)
-        {
-            unsigned char *mem = vec2_mem(vec_ptr, el_size);
+    return TRUE;
+}
 
-            memmove(mem, vec2_data(vec_ptr), el_size * vec2_size(vec_ptr));
-            vec_ptr->data = mem;
-            vec2_start(vec_ptr) = 0;
+void vec2_arena_reset(struct vec2_arena *arena_ptr)
+{
+    if ((arena_ptr != NULL) && (arena_ptr->_blocks != NULL))
+    {
+        if (arena_ptr->_blocks->next == NULL)
+        {
+            arena_ptr->_blocks->used = 0;
         }
+        else
+        {
+            size_t total_size = 0;
+            struct _vec2_arena_block *block = arena_ptr->_blocks;
+
+            for (; block != NULL; block = block->next)
+            {
+                /* Saturate instead of overflowing. The allocation would fail anyway */
+                total_size = (total_size + block->size < total_size) ?
+                    (size_t)-1 : total_size + block->size;
+            }
 
-        new_mem = (unsigned char *)realloc(vec2_data(vec_ptr), new_capacity * el_size);
+            vec2_arena_destroy(arena_ptr);
 
-        if (new_mem == NULL)
-        {
-            return FALSE;
+            /* Coalesce the blocks into one. It's fine if this fails, as another attempt
+             * will be made on the next allocation */
+            (void)_vec2_arena_new_block(arena_ptr, total_size);
         }
 
-        vec_ptr->data = new_mem;
-        vec_ptr->capacity = vec2_size(vec_ptr);
+        arena_ptr->_last = NULL;
     }
-
-    return TRUE;
 }
 
-int _vec2_impl_create_hole(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, size_t el_size)
+void vec2_arena_destroy(struct vec2_arena *arena_ptr)
 {
-    if (!_vec2_impl_valid(vec_ptr) || (len <= 0) || !el_size ||
-        !_vec2_create_hole(vec_ptr, idx, len, el_size))
+    if (arena_ptr != NULL)
     {
-        return FALSE;
-    }
+        while (arena_ptr->_blocks != NULL)
+        {
+            struct _vec2_arena_block *next = arena_ptr->_blocks->next;
 
+            free(arena_ptr->_blocks);
+            arena_ptr->_blocks = next;
+        }
 
-    vec_ptr->_idx[0] = idx;
-    return TRUE;
+        arena_ptr->_last = NULL;
+    }
 }
 
-int _vec2_impl_swap(struct _vec2_impl_struct *vec_ptr, size_t first, size_t second, size_t el_size)
+int vec2_mmap_init(struct vec2_mmap *mmap_ptr, size_t threshold)
 {
-    if (!_vec2_impl_valid(vec_ptr) ||
-        (first >= vec2_size(vec_ptr)) || (second >= vec2_size(vec_ptr)) || !el_size)
+    if (mmap_ptr == NULL)
     {
         return FALSE;
     }
 
-    /* Check if we need to do anything */
-    if (first != second)
-    {
-        union
-        {
-            size_t align_dummy;
-            unsigned char bytes[VEC2_SWAP_SIZE];
-        } swap;
-        size_t left_bytes = el_size;
+    mmap_ptr->_allocator.ctx = mmap_ptr;
+    mmap_ptr->_allocator.allocate = _vec2_mmap_allocate;
+    mmap_ptr->_allocator.reallocate = _vec2_mmap_reallocate;
+    mmap_ptr->_allocator.deallocate = _vec2_mmap_deallocate;
+    mmap_ptr->_allocator.allocate_zeroed = _vec2_mmap_allocate_zeroed;
+    mmap_ptr->_threshold = threshold ? threshold : VEC2_MMAP_THRESHOLD;
+    mmap_ptr->_huge_threshold = 0;
+    mmap_ptr->_page_size = VEC2_PAGE_SIZE;
 
-        for (; left_bytes >= sizeof(swap); left_bytes -= sizeof(swap))
-        {
-            memcpy(swap.bytes, VEC2_GET(vec_ptr, el_size, first), sizeof(swap));
-            memcpy(VEC2_GET(vec_ptr, el_size, first), VEC2_GET(vec_ptr, el_size, second), sizeof(swap));
-            memcpy(VEC2_GET(vec_ptr, el_size, second), swap.bytes, sizeof(swap));
-        }
+#ifdef VEC2_HAVE_MREMAP
+    {
+        long page_size = sysconf(_SC_PAGESIZE);
 
-        if (left_bytes)
+        if (page_size > 0)
         {
-            memcpy(swap.bytes, VEC2_GET(vec_ptr, el_size, first), left_bytes);
-            memcpy(VEC2_GET(vec_ptr, el_size, first), VEC2_GET(vec_ptr, el_size, second), left_bytes);
-            memcpy(VEC2_GET(vec_ptr, el_size, second), swap.bytes, left_bytes);
+            mmap_ptr->_page_size = (size_t)page_size;
         }
     }
+#endif /* VEC2_HAVE_MREMAP */
 
     return TRUE;
 }
 
-int _vec2_impl_sort(struct _vec2_impl_struct *vec_ptr, _vec2_impl_cmpfn cmpfn, size_t el_size)
+int vec2_mmap_set_huge_pages(struct vec2_mmap *mmap_ptr, size_t threshold)
 {
-    if (!_vec2_impl_valid(vec_ptr) || (cmpfn == NULL) || !el_size)
+#if defined(VEC2_HAVE_MREMAP) && defined(MADV_HUGEPAGE)
+    if (mmap_ptr == NULL)
     {
         return FALSE;
     }
 
-    /* Check if we need to sort anything */
-    if (vec2_size(vec_ptr))
-    {
-        qsort(VEC2_GET(vec_ptr, el_size, 0), vec2_size(vec_ptr), el_size, cmpfn);
-    }
+    /* Only mapped buffers can use huge pages */
+    mmap_ptr->_huge_threshold = (threshold && (threshold < mmap_ptr->_threshold)) ?
+        mmap_ptr->_threshold : threshold;
 
     return TRUE;
+#else
+    (void)mmap_ptr;
+    (void)threshold;
+
+    return FALSE;
+#endif /* VEC2_HAVE_MREMAP && MADV_HUGEPAGE */
 }
 
-int _vec2_impl_assign(struct _vec2_impl_struct *vec_ptr, size_t idx, const void *val, size_t len, size_t el_size)
+int vec2_cache_init(struct vec2_cache *cache_ptr, const struct vec2_allocator *backing, size_t limit)
 {
-    if (!_vec2_impl_valid(vec_ptr) || (val == NULL) || !el_size ||
-        (idx >= vec2_size(vec_ptr)) || (vec2_size(vec_ptr) - idx < len))
+    if ((cache_ptr == NULL) ||
+        ((backing != NULL) &&
+         ((backing->allocate == NULL) || (backing->reallocate == NULL) || (backing->deallocate == NULL))))
     {
         return FALSE;
     }
 
-    memmove(VEC2_GET(vec_ptr, el_size, idx), val, len * el_size);
+    memset(cache_ptr, 0, sizeof(*cache_ptr));
+    cache_ptr->_allocator.ctx = cache_ptr;
+    cache_ptr->_allocator.allocate = _vec2_cache_allocate;
+    cache_ptr->_allocator.reallocate = _vec2_cache_reallocate;
+    cache_ptr->_allocator.deallocate = _vec2_cache_deallocate;
+    cache_ptr->_backing = backing;
+    cache_ptr->_limit = limit ? limit : VEC2_CACHE_LIMIT;
+
     return TRUE;
 }
 
-int _vec2_impl_remove(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, size_t el_size, void *out)
+void vec2_cache_flush(struct vec2_cache *cache_ptr)
 {
-    if (!_vec2_impl_valid(vec_ptr) || !el_size)
+    const struct vec2_allocator *backing = NULL;
+    size_t class_idx;
+
+    if (cache_ptr == NULL)
     {
-        return FALSE;
+        return;
     }
 
-    return _vec2_remove(vec_ptr, idx, len, el_size, out);
+    backing = vec2_cache_backing(cache_ptr);
+
+    for (class_idx = 0; class_idx < _VEC2_IMPL_CACHE_CLASSES; ++class_idx)
+    {
+        while (cache_ptr->_bins[class_idx] != NULL)
+        {
+            void *ptr = cache_ptr->_bins[class_idx];
+
+            memcpy(&cache_ptr->_bins[class_idx], ptr, sizeof(ptr));
+            backing->deallocate(backing->ctx, ptr, VEC2_CACHE_MIN_SIZE << class_idx, VEC2_MAX_ALIGN);
+        }
+    }
+
+    cache_ptr->_bytes = 0;
 }
 
-int _vec2_impl_insert(struct _vec2_impl_struct *vec_ptr, size_t idx, const void *val, size_t len, size_t el_size)
+void vec2_cache_stats(const struct vec2_cache *cache_ptr, size_t *hits_out, size_t *misses_out, size_t *bytes_out)
 {
-    if (!_vec2_impl_valid(vec_ptr) || (val == NULL) || !el_size)
+    if (hits_out)
     {
-        return FALSE;
+        *hits_out = cache_ptr ? cache_ptr->_hits : 0;
     }
 
-    if (len > 0)
+    if (misses_out)
     {
-        if (!_vec2_create_hole(vec_ptr, idx, len, el_size))
-        {
-            return FALSE;
-        }
+        *misses_out = cache_ptr ? cache_ptr->_misses : 0;
+    }
 
-        /* Copy len elements from val into the free slots */
-        memcpy(VEC2_GET(vec_ptr, el_size, idx), val, el_size * len);
-        vec_ptr->size += len;
+    if (bytes_out)
+    {
+        *bytes_out = cache_ptr ? cache_ptr->_bytes : 0;
     }
+}
 
-    return TRUE;
+struct vec2_cache *vec2_thread_cache(void)
+{
+#ifdef VEC2_THREAD_LOCAL
+    return _vec2_thread_cache_get();
+#else
+    return NULL;
+#endif /* VEC2_THREAD_LOCAL */
 }
 
-void _vec2_impl_clear(struct _vec2_impl_struct *vec_ptr, size_t el_size)
+const struct vec2_allocator *vec2_thread_cache_allocator(void)
 {
-    if (_vec2_impl_valid(vec_ptr))
-    {
-        _vec2_clear(vec_ptr, el_size);
-    }
+#ifdef VEC2_THREAD_LOCAL
+    return &_vec2_thread_cache_allocator;
+#else
+    /* Without thread local storage, vectors just use the heap */
+    return NULL;
+#endif /* VEC2_THREAD_LOCAL */
 }
 
 #ifdef __cplusplus
@@ -76,6 +76,81 @@
      ((!vec2_capacity(vec_ptr) && vec2_data(vec_ptr) == NULL) || \
       (vec2_size(vec_ptr) <= vec2_capacity(vec_ptr))))
 
+/**
+ * @internal
+ * Calculates the base 2 logarithm of a constant power of two up to <code>VEC2_MAX_ALIGNMENT</code>.
+ */
+#define _vec2_impl_log2(n) \
+    ((n) >= 32768 ? 15 : (n) >= 16384 ? 14 : (n) >= 8192 ? 13 : (n) >= 4096 ? 12 : \
+     (n) >= 2048  ? 11 : (n) >= 1024  ? 10 : (n) >= 512  ?  9 : (n) >= 256  ?  8 : \
+     (n) >= 128   ?  7 : (n) >= 64    ?  6 : (n) >= 32   ?  5 : (n) >= 16   ?  4 : \
+     (n) >= 8     ?  3 : (n) >= 4     ?  2 : (n) >= 2    ?  1 : 0)
+
+/**
+ * @internal
+ * Evaluates to 0 if a constant alignment is 0 or a power of two up to <code>VEC2_MAX_ALIGNMENT</code>,
+ * and fails to compile otherwise (so that <code>_vec2_impl_log2</code> never rounds it silently).
+ */
+#define _vec2_impl_check_alignment(n) \
+    (0 * sizeof(char[(((n) & ((n) - 1)) || ((n) > VEC2_MAX_ALIGNMENT)) ? -1 : 1]))
+
+/**
+ * @internal
+ * Marks a <code>vec</code> whose buffer doesn't belong to its allocator, and so must never be
+ * reallocated or freed. The low bits of the flags hold the base 2 logarithm of the alignment.
+ */
+#define _VEC2_IMPL_FLAG_BORROWED 0x20u
+
+/**
+ * @internal
+ * Marks a <code>vec</code> whose capacity can't change, so that it never allocates memory.
+ */
+#define _VEC2_IMPL_FLAG_FIXED 0x40u
+
+/**
+ * @internal
+ * The number of size classes of a buffer cache. The classes are powers of two from 64 bytes to 1MB.
+ */
+#define _VEC2_IMPL_CACHE_CLASSES 15
+
+/**
+ * @internal
+ * The number of elements below which the sorts defined with <code>VEC2_DEFINE_SORT</code>
+ * switch to insertion sort.
+ */
+#define _VEC2_IMPL_SORT_THRESHOLD 16
+
+/**
+ * @internal
+ * Hints the CPU to start loading the memory at an address into the cache, if the compiler
+ * supports it.
+ */
+#if defined(__GNUC__)
+#    define _vec2_impl_prefetch(addr) __builtin_prefetch(addr)
+#else
+#    define _vec2_impl_prefetch(addr) ((void)0)
+#endif
+
+/**
+ * @internal
+ * The number of consecutive elements of an Eytzinger layout that a 64 byte cache line holds, as a
+ * power of two. A search prefetches the descendants of a node that are this many nodes ahead.
+ */
+#define _vec2_impl_prefetch_span(el_size) \
+    ((el_size) <= 4 ? 16 : (el_size) <= 8 ? 8 : (el_size) <= 16 ? 4 : (el_size) <= 32 ? 2 : 1)
+
+/**
+ * @internal
+ * Gets the node (counting from 1) where an Eytzinger search last went left, or 0 if it never did,
+ * from the node past the bottom of the tree where it stopped, by undoing the steps to the right
+ * (the trailing 1 bits) and the step to the left before them.
+ */
+#if defined(__GNUC__)
+#    define _vec2_impl_eytzinger_node(node) ((node) >> ((__extension__ __builtin_ctzll(~(unsigned long long)(node))) + 1))
+#else
+#    define _vec2_impl_eytzinger_node(node) ((node) / (((node) ^ ((node) + 1)) + 1))
+#endif
+
 /****************************************************************************************
   Internal Type Definitions
  ***************************************************************************************/
@@ -85,12 +160,135 @@
  */
 struct _vec2_impl_struct;
 
+/**
+ * @internal
+ * Forward declaration of the memory block structure of an arena
+ */
+struct _vec2_arena_block;
+
 /**
  * @internal
  * Defines the generic comparer function.
  */
 typedef int (*_vec2_impl_cmpfn)(const void *, const void *);
 
+/**
+ * @internal
+ * Defines the generic predicate function.
+ */
+typedef int (*_vec2_impl_predfn)(const void *, void *);
+
+/****************************************************************************************
+  External Type Definitions
+ ***************************************************************************************/
+/**
+ * Defines an allocator that a <code>vec</code> uses to manage its underlying memory buffer.
+ *
+ * Each function receives the <code>ctx</code> member as its first argument. All sizes are
+ * in bytes, and the size passed along with an existing block is always the size that was
+ * last requested for it, so allocators don't need to keep track of block sizes on their own.
+ * <code>reallocate</code> must behave like <code>realloc</code> and preserve the contents
+ * of the block up to the smaller of the two sizes.
+ *
+ * <code>align</code> is the alignment that the block must have. It's always a power of two,
+ * and it's always the same for all the calls concerning a specific block. Alignments that
+ * <code>malloc</code> already guarantees don't require any special handling.
+ *
+ * <code>allocate_zeroed</code> is optional, and behaves like <code>allocate</code> except that
+ * the block must be zero-filled. Allocators that can get zeroed memory for free (e.g. using
+ * <code>calloc</code> or fresh pages from the kernel) should provide it. When it's NULL,
+ * blocks from <code>allocate</code> are cleared using <code>memset</code> instead.
+ */
+struct vec2_allocator
+{
+    void  *ctx;
+    void *(*allocate)(void *ctx, size_t size, size_t align);
+    void *(*reallocate)(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align);
+    void  (*deallocate)(void *ctx, void *ptr, size_t size, size_t align);
+    void *(*allocate_zeroed)(void *ctx, size_t size, size_t align);
+};
+
+/**
+ * Defines a growth policy, which decides by how much a <code>vec</code> grows when it runs out of capacity.
+ *
+ * <code>next_capacity</code> receives the policy itself, the current capacity of the <code>vec</code>,
+ * the capacity required for the pending insertion (both in elements), and the size of an element.
+ * It returns the new capacity in elements. If that's less than the required capacity, or if the
+ * allocation of the suggested capacity fails, the <code>vec</code> grows to exactly the required
+ * capacity instead. <code>initial</code> is also the smallest capacity that
+ * <code>vec2_shrink_to_fit</code> would shrink to. The rest of the members are parameters of the
+ * built-in policies, and can be used freely by custom ones.
+ */
+struct vec2_growth
+{
+    size_t (*next_capacity)(const struct vec2_growth *growth, size_t capacity, size_t required, size_t el_size);
+    size_t   initial;
+    size_t   factor_num;
+    size_t   factor_den;
+    size_t   step;
+    void    *ctx;
+};
+
+/**
+ * Defines a bump-pointer arena that vectors can allocate their memory buffers from.
+ *
+ * Memory is carved from large blocks and is only released in bulk by resetting the arena.
+ * The most recent allocation is special: it can grow and shrink in place as long as there's
+ * room for it in the current block, and deallocating it returns its memory to the arena.
+ * Other deallocations are no-ops.
+ *
+ * All of the members are internal. Use <code>vec2_arena_allocator</code> to get the allocator
+ * that vectors should use.
+ */
+struct vec2_arena
+{
+    struct vec2_allocator     _allocator;
+    struct _vec2_arena_block *_blocks;
+    size_t                    _block_size;
+    void                     *_last;
+};
+
+/**
+ * Defines an allocator for large buffers that maps them directly from the kernel.
+ *
+ * Buffers that are smaller than a threshold come from the standard library's heap, and larger
+ * buffers are mapped using <code>mmap</code> and grown using <code>mremap</code>, which lets the
+ * kernel move the pages of the buffer instead of copying its contents. On platforms that don't
+ * support <code>mremap</code> all of the buffers come from the standard library's heap.
+ *
+ * All of the members are internal. Use <code>vec2_mmap_allocator</code> to get the allocator
+ * that vectors should use.
+ */
+struct vec2_mmap
+{
+    struct vec2_allocator _allocator;
+    size_t                _threshold;
+    size_t                _huge_threshold;
+    size_t                _page_size;
+};
+
+/**
+ * Defines a cache of freed buffers that vectors can reuse instead of going back to the heap.
+ *
+ * Buffers of up to 1MB are rounded up to power of two size classes, and freed buffers are kept
+ * in per class lists until the total size of the cached buffers reaches a limit. Growing a buffer
+ * within its size class doesn't need any allocation at all. Bigger (or over-aligned) buffers go
+ * straight to the backing allocator. A cache must only be used by a single thread at a time.
+ *
+ * All of the members are internal. Use <code>vec2_cache_allocator</code> to get the allocator
+ * that vectors should use, and <code>vec2_cache_stats</code> to read the counters.
+ */
+struct vec2_cache
+{
+    struct vec2_allocator        _allocator;
+    const struct vec2_allocator *_backing;
+    void                        *_bins[_VEC2_IMPL_CACHE_CLASSES];
+    size_t                       _bytes;
+    size_t                       _limit;
+    size_t                       _hits;
+    size_t                       _misses;
+};
+
 /****************************************************************************************
   Internal Function Declarations
  ***************************************************************************************/
@@ -103,11 +301,30 @@ extern "C" {
  * @brief   Initializes a <code>vec</code>
  *
  * @param[in] vec_ptr   Pointer to a gneric <code>vec</code> structure to initialize.
+ * @param[in] alloc     Optional pointer to the allocator to use for the <code>vec</code>.
+ * @param[in] growth    Optional pointer to the growth policy to use for the <code>vec</code>.
+ * @param[in] alignment The alignment of the data of the <code>vec</code>. 0 for the default alignment.
  *
  * @return    TRUE if the initialization succeeded.
  *            FALSE otherwise.
  */
-extern int (_vec2_impl_init)(struct _vec2_impl_struct *vec_ptr);
+extern int (_vec2_impl_init)(struct _vec2_impl_struct *vec_ptr,
+    const struct vec2_allocator *alloc, const struct vec2_growth *growth, size_t alignment);
+
+/**
+ * @internal
+ * @brief   Initializes a <code>vec</code> over a buffer that it doesn't own
+ *
+ * @param[in] vec_ptr   Pointer to a generic <code>vec</code> structure.
+ * @param[in] buf       The buffer to store the elements in.
+ * @param[in] capacity  The number of elements that fit in <code>buf</code>.
+ * @param[in] fixed     Whether the <code>vec</code> must fail to grow beyond <code>capacity</code>
+ *                      rather than move to a buffer of its own.
+ *
+ * @return    TRUE if the initialization succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_init_buffer)(struct _vec2_impl_struct *vec_ptr, void *buf, size_t capacity, int fixed);
 
 /**
  * @internal
@@ -122,6 +339,20 @@ extern int (_vec2_impl_init)(struct _vec2_impl_struct *vec_ptr);
  */
 extern int (_vec2_impl_reserve)(struct _vec2_impl_struct *vec_ptr, size_t additional, size_t el_size);
 
+/**
+ * @internal
+ * @brief   Changes the number of elements in a <code>vec</code>
+ *
+ * @param[in] vec_ptr   Pointer to a generic <code>vec</code> structure.
+ * @param[in] new_size  The new number of elements.
+ * @param[in] zeroed    Whether new elements are zero-filled rather than left uninitialized.
+ * @param[in] el_size   The size of an element in the <code>vec</code>.
+ *
+ * @return    TRUE if the resizing succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_resize)(struct _vec2_impl_struct *vec_ptr, size_t new_size, int zeroed, size_t el_size);
+
 /**
  * @internal
  * @brief   Shrinks the underlying memory bufer of the <code>vec</code> to fit its size.
@@ -165,6 +396,31 @@ extern int (_vec2_impl_create_hole)(struct _vec2_impl_struct *vec_ptr, size_t id
  */
 extern int (_vec2_impl_swap)(struct _vec2_impl_struct *vec_ptr, size_t first, size_t second, size_t el_size);
 
+/**
+ * @internal
+ * @brief   Reverses the order of the elements in a <code>vec</code>
+ *
+ * @param[in]  vec_ptr  Pointer to a generic <code>vec</code> structure.
+ * @param[in]  el_size  The size of an element in the <code>vec</code>.
+ *
+ * @return     TRUE if the reversal suceeded.
+ *             FALSE otherwise.
+ */
+extern int (_vec2_impl_reverse)(struct _vec2_impl_struct *vec_ptr, size_t el_size);
+
+/**
+ * @internal
+ * @brief   Rotates the elements in a <code>vec</code> to the left
+ *
+ * @param[in]  vec_ptr  Pointer to a generic <code>vec</code> structure.
+ * @param[in]  shift    The amount of positions to rotate the elements by.
+ * @param[in]  el_size  The size of an element in the <code>vec</code>.
+ *
+ * @return     TRUE if the rotation suceeded.
+ *             FALSE otherwise.
+ */
+extern int (_vec2_impl_rotate)(struct _vec2_impl_struct *vec_ptr, size_t shift, size_t el_size);
+
 /**
  * @internal
  * @brief   Sorts a <code>vec</code>
@@ -178,6 +434,113 @@ extern int (_vec2_impl_swap)(struct _vec2_impl_struct *vec_ptr, size_t first, si
  */
 extern int (_vec2_impl_sort)(struct _vec2_impl_struct *vec_ptr, _vec2_impl_cmpfn cmpfn, size_t el_size);
 
+/**
+ * @internal
+ * @brief   Sorts a <code>vec</code> while keeping the order of equal elements
+ *
+ * @param[in]  vec_ptr      Pointer to a generic <code>vec</code> structure.
+ * @param[in]  cmpfn        Pointer to comparer function.
+ * @param[in]  scratch_ptr  Optional pointer to a generic <code>vec</code> structure to use as scratch space.
+ * @param[in]  el_size      The size of an element in the <code>vec</code>.
+ *
+ * @return    TRUE if the sort succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_stable_sort)(struct _vec2_impl_struct *vec_ptr, _vec2_impl_cmpfn cmpfn,
+    struct _vec2_impl_struct *scratch_ptr, size_t el_size);
+
+/**
+ * @internal
+ * @brief   Sorts a <code>vec</code> using multiple threads
+ *
+ * @param[in]  vec_ptr       Pointer to a generic <code>vec</code> structure.
+ * @param[in]  cmpfn         Pointer to comparer function.
+ * @param[in]  thread_count  The maximal number of threads to use, or 0 for the number of CPUs.
+ * @param[in]  el_size       The size of an element in the <code>vec</code>.
+ *
+ * @return    TRUE if the sort succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_parallel_sort)(struct _vec2_impl_struct *vec_ptr, _vec2_impl_cmpfn cmpfn, size_t thread_count,
+    size_t el_size);
+
+/**
+ * @internal
+ * @brief   Sorts a <code>vec</code> by a numeric key using radix sort
+ *
+ * @param[in]  vec_ptr      Pointer to a generic <code>vec</code> structure.
+ * @param[in]  kind         The kind of the key (one of <code>VEC2_KEY_*</code>).
+ * @param[in]  key_offset   The offset of the key in an element.
+ * @param[in]  key_size     The size of the key.
+ * @param[in]  scratch_ptr  Optional pointer to a generic <code>vec</code> structure to use as scratch space.
+ * @param[in]  el_size      The size of an element in the <code>vec</code>.
+ *
+ * @return    TRUE if the sort succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_radix_sort)(struct _vec2_impl_struct *vec_ptr, int kind, size_t key_offset, size_t key_size,
+    struct _vec2_impl_struct *scratch_ptr, size_t el_size);
+
+/**
+ * @internal
+ * @brief   Finds the first element in a sorted <code>vec</code> that isn't ordered before a key
+ *
+ * @param[in] vec_ptr   Pointer to a generic <code>vec</code> structure.
+ * @param[in] key       Pointer to the key.
+ * @param[in] cmpfn     Pointer to comparer function.
+ * @param[in] upper     Non-zero to find the first element that is ordered after the key instead.
+ * @param[in] el_size   The size of an element in the <code>vec</code>.
+ *
+ * @return     The index of the element, or the size of the <code>vec</code> if there is none.
+ */
+extern size_t (_vec2_impl_bound)(struct _vec2_impl_struct *vec_ptr, const void *key, _vec2_impl_cmpfn cmpfn,
+    int upper, size_t el_size);
+
+/**
+ * @internal
+ * @brief   Finds the range of elements in a sorted <code>vec</code> that are equal to a key
+ *
+ * @param[in]  vec_ptr    Pointer to a generic <code>vec</code> structure.
+ * @param[in]  key        Pointer to the key.
+ * @param[in]  cmpfn      Pointer to comparer function.
+ * @param[out] first_out  Optional pointer that receives the index of the first equal element.
+ * @param[out] last_out   Optional pointer that receives the index past the last equal element.
+ * @param[in]  el_size    The size of an element in the <code>vec</code>.
+ *
+ * @return     TRUE if the search succeeded.
+ *             FALSE otherwise.
+ */
+extern int (_vec2_impl_equal_range)(struct _vec2_impl_struct *vec_ptr, const void *key, _vec2_impl_cmpfn cmpfn,
+    size_t *first_out, size_t *last_out, size_t el_size);
+
+/**
+ * @internal
+ * @brief   Copies the elements of a sorted <code>vec</code> to another <code>vec</code> in Eytzinger order
+ *
+ * @param[in] dst_ptr   Pointer to a generic <code>vec</code> structure to copy the elements to.
+ * @param[in] src_ptr   Pointer to a generic <code>vec</code> structure to copy the elements from.
+ * @param[in] el_size   The size of an element in the <code>vec</code>.
+ *
+ * @return     TRUE if the copy succeeded.
+ *             FALSE otherwise.
+ */
+extern int (_vec2_impl_eytzinger_build)(struct _vec2_impl_struct *dst_ptr, const struct _vec2_impl_struct *src_ptr,
+    size_t el_size);
+
+/**
+ * @internal
+ * @brief   Finds the first element in a <code>vec</code> in Eytzinger order that isn't ordered before a key
+ *
+ * @param[in] vec_ptr   Pointer to a generic <code>vec</code> structure.
+ * @param[in] key       Pointer to the key.
+ * @param[in] cmpfn     Pointer to comparer function.
+ * @param[in] el_size   The size of an element in the <code>vec</code>.
+ *
+ * @return     The index of the element, or the size of the <code>vec</code> if there is none.
+ */
+extern size_t (_vec2_impl_eytzinger_search)(struct _vec2_impl_struct *vec_ptr, const void *key,
+    _vec2_impl_cmpfn cmpfn, size_t el_size);
+
 /**
  * @internal
  * @brief   Assigns one or more elements at a specific index in a <code>vec</code>
@@ -193,6 +556,35 @@ extern int (_vec2_impl_sort)(struct _vec2_impl_struct *vec_ptr, _vec2_impl_cmpfn
  */
 extern int (_vec2_impl_assign)(struct _vec2_impl_struct *vec_ptr, size_t idx, const void *val, size_t len, size_t el_size);
 
+/**
+ * @internal
+ * @brief   Assigns the same value to a range of elements in a <code>vec</code>
+ *
+ * @param[in] vec_ptr   Pointer to a generic <code>vec</code> structure.
+ * @param[in] idx       The index of the first element to assign.
+ * @param[in] len       The amount of elements to assign.
+ * @param[in] val       Pointer to the value to assign.
+ * @param[in] el_size   The size of an element in the <code>vec</code>.
+ *
+ * @return    TRUE if the assignment succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_fill)(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, const void *val, size_t el_size);
+
+/**
+ * @internal
+ * @brief   Pushes multiple copies of a value to the end of a <code>vec</code>
+ *
+ * @param[in] vec_ptr   Pointer to a generic <code>vec</code> structure.
+ * @param[in] val       Pointer to the value to push.
+ * @param[in] len       The amount of copies to push.
+ * @param[in] el_size   The size of an element in the <code>vec</code>.
+ *
+ * @return    TRUE if the push succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_push_repeat)(struct _vec2_impl_struct *vec_ptr, const void *val, size_t len, size_t el_size);
+
 /**
  * @internal
  * @brief   Inserts one or more elements at a specific index in a <code>vec</code>
@@ -208,6 +600,40 @@ extern int (_vec2_impl_assign)(struct _vec2_impl_struct *vec_ptr, size_t idx, co
  */
 extern int (_vec2_impl_insert)(struct _vec2_impl_struct *vec_ptr, size_t idx, const void *val, size_t len, size_t el_size);
 
+/**
+ * @internal
+ * @brief   Replaces a range of elements in a <code>vec</code> with other elements
+ *
+ * @param[in]  vec_ptr     Pointer to a generic <code>vec</code> structure.
+ * @param[in]  idx         The index of the first element to replace.
+ * @param[in]  remove_len  The amount of elements to remove.
+ * @param[in]  val         Pointer to the elements to insert.
+ * @param[in]  insert_len  The amount of elements to insert.
+ * @param[in]  el_size     The size of an element in the <code>vec</code>.
+ * @param[out] out         Optional pointer to store the removed elements in.
+ *
+ * @return    TRUE if the replacement succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_splice)(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t remove_len, const void *val,
+    size_t insert_len, size_t el_size, void *out);
+
+/**
+ * @internal
+ * @brief   Inserts multiple elements at different indices in a <code>vec</code> at once
+ *
+ * @param[in] vec_ptr  Pointer to a generic <code>vec</code> structure.
+ * @param[in] idx_arr  The sorted indices at which to insert the elements.
+ * @param[in] val      The array of elements to insert.
+ * @param[in] count    The amount of elements to insert.
+ * @param[in] el_size  The size of an element in the <code>vec</code>.
+ *
+ * @return    TRUE if the insertion succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_insert_indices)(struct _vec2_impl_struct *vec_ptr, const size_t *idx_arr, const void *val,
+    size_t count, size_t el_size);
+
 /**
  * @internal
  * @brief   Removes elements at a specific index from a <code>vec</code>
@@ -223,6 +649,82 @@ extern int (_vec2_impl_insert)(struct _vec2_impl_struct *vec_ptr, size_t idx, co
  */
 extern int (_vec2_impl_remove)(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t len, size_t el_size, void *out);
 
+/**
+ * @internal
+ * @brief   Moves all the elements of a <code>vec</code> to the end of another <code>vec</code>
+ *
+ * @param[in] dst_ptr   Pointer to the generic <code>vec</code> structure to append to.
+ * @param[in] src_ptr   Pointer to the generic <code>vec</code> structure whose elements are moved.
+ * @param[in] el_size   The size of an element in the <code>vec</code>s.
+ *
+ * @return    TRUE if the elements were moved.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_append)(struct _vec2_impl_struct *dst_ptr, struct _vec2_impl_struct *src_ptr, size_t el_size);
+
+/**
+ * @internal
+ * @brief   Removes the elements of a <code>vec</code> according to a predicate in a single pass
+ *
+ * @param[in] vec_ptr       Pointer to a generic <code>vec</code> structure.
+ * @param[in] predfn        The predicate to apply to each element.
+ * @param[in] ctx           Context to pass to the predicate.
+ * @param[in] keep_matches  Whether elements that match the predicate are kept rather than removed.
+ * @param[in] removed_ptr   Optional pointer to a generic <code>vec</code> to append the removed elements to.
+ * @param[in] el_size       The size of an element in the <code>vec</code>.
+ *
+ * @return    TRUE if the removal succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_retain)(struct _vec2_impl_struct *vec_ptr, _vec2_impl_predfn predfn, void *ctx, int keep_matches,
+    struct _vec2_impl_struct *removed_ptr, size_t el_size);
+
+/**
+ * @internal
+ * @brief   Removes multiple elements from a <code>vec</code> in a single pass
+ *
+ * @param[in]  vec_ptr  Pointer to a generic <code>vec</code> structure.
+ * @param[in]  idx_arr  The indices of the elements to remove, in strictly ascending order.
+ * @param[in]  count    The number of indices in <code>idx_arr</code>.
+ * @param[in]  el_size  The size of an element in the <code>vec</code>.
+ * @param[out] out      Optional pointer to store the removed elements in.
+ *
+ * @return    TRUE if the removal succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_remove_indices)(struct _vec2_impl_struct *vec_ptr, const size_t *idx_arr, size_t count,
+    size_t el_size, void *out);
+
+/**
+ * @internal
+ * @brief   Removes an element from a <code>vec</code> by moving the last element in its place
+ *
+ * @param[in]  vec_ptr  Pointer to a generic <code>vec</code> structure.
+ * @param[in]  idx      The index of the element to remove.
+ * @param[in]  el_size  The size of an element in the <code>vec</code>.
+ * @param[out] out      Optional pointer to store the removed element in.
+ *
+ * @return    TRUE if the removal succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_swap_remove)(struct _vec2_impl_struct *vec_ptr, size_t idx, size_t el_size, void *out);
+
+/**
+ * @internal
+ * @brief   Removes multiple elements from a <code>vec</code> by moving elements from its end in their place
+ *
+ * @param[in]  vec_ptr  Pointer to a generic <code>vec</code> structure.
+ * @param[in]  idx_arr  The indices of the elements to remove, in strictly ascending order.
+ * @param[in]  count    The number of indices in <code>idx_arr</code>.
+ * @param[in]  el_size  The size of an element in the <code>vec</code>.
+ * @param[out] out      Optional pointer to store the removed elements in.
+ *
+ * @return    TRUE if the removal succeeded.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_swap_remove_indices)(struct _vec2_impl_struct *vec_ptr, const size_t *idx_arr, size_t count,
+    size_t el_size, void *out);
+
 /**
  * @internal
  * @brief   Clears a <code>vec</code>
@@ -235,6 +737,185 @@ extern int (_vec2_impl_remove)(struct _vec2_impl_struct *vec_ptr, size_t idx, si
  */
 extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size);
 
+/**
+ * @internal
+ * @brief   Makes a <code>vec</code> take ownership of a buffer
+ *
+ * @param[in] vec_ptr   Pointer to a generic <code>vec</code> structure.
+ * @param[in] buf       The buffer to take ownership of.
+ * @param[in] size      The number of elements in <code>buf</code>.
+ * @param[in] capacity  The number of elements that fit in <code>buf</code>.
+ * @param[in] el_size   The size of an element in the <code>vec</code>.
+ *
+ * @return    TRUE if the buffer was adopted.
+ *            FALSE otherwise.
+ */
+extern int (_vec2_impl_adopt)(struct _vec2_impl_struct *vec_ptr, void *buf, size_t size, size_t capacity, size_t el_size);
+
+/**
+ * @internal
+ * @brief   Detaches the buffer of a <code>vec</code> from it
+ *
+ * @param[in] vec_ptr       Pointer to a generic <code>vec</code> structure.
+ * @param[out] size_out     Optional pointer to store the number of elements in the buffer.
+ * @param[out] capacity_out Optional pointer to store the number of elements that fit in the buffer.
+ * @param[in] el_size       The size of an element in the <code>vec</code>.
+ *
+ * @return    The detached buffer, or NULL if there's no buffer that can be detached.
+ */
+extern void *(_vec2_impl_take)(struct _vec2_impl_struct *vec_ptr, size_t *size_out, size_t *capacity_out, size_t el_size);
+
+/****************************************************************************************
+  External Function Declarations
+ ***************************************************************************************/
+/**
+ * @brief   A growth policy that multiplies the capacity by a constant factor
+ *
+ * Starts at <code>initial</code> elements and multiplies the capacity by
+ * <code>factor_num / factor_den</code> until the required capacity is reached.
+ * Use <code>VEC2_GROWTH_GEOMETRIC</code> to define it.
+ */
+extern size_t vec2_growth_geometric(const struct vec2_growth *growth, size_t capacity, size_t required, size_t el_size);
+
+/**
+ * @brief   A growth policy that grows geometrically and rounds the buffer up to whole pages
+ *
+ * Grows like <code>vec2_growth_geometric</code>, and then rounds the capacity up so that
+ * the size of the buffer in bytes is a multiple of <code>step</code>.
+ * Use <code>VEC2_GROWTH_PAGED</code> to define it.
+ */
+extern size_t vec2_growth_paged(const struct vec2_growth *growth, size_t capacity, size_t required, size_t el_size);
+
+/**
+ * @brief   A growth policy that grows in fixed-size chunks
+ *
+ * Starts at <code>initial</code> elements and grows by multiples of <code>step</code> elements.
+ * Use <code>VEC2_GROWTH_CHUNKED</code> to define it.
+ */
+extern size_t vec2_growth_chunked(const struct vec2_growth *growth, size_t capacity, size_t required, size_t el_size);
+
+/**
+ * @brief   Initializes an arena
+ *
+ * @param[in] arena_ptr  Pointer to the arena structure to initialize.
+ * @param[in] block_size The minimal size in bytes of the blocks the arena allocates
+ *                       memory from. 0 to use a default size.
+ *
+ * @note      No memory is allocated until the first allocation from the arena.
+ *
+ * @return    TRUE if the initialization succeeded.
+ *            FALSE otherwise.
+ */
+extern int vec2_arena_init(struct vec2_arena *arena_ptr, size_t block_size);
+
+/**
+ * @brief   Releases all of the allocations made from an arena at once
+ *
+ * @param[in] arena_ptr  Pointer to an initialized arena structure.
+ *
+ * @note      All of the vectors that use the arena must be either cleared or re-initialized
+ *            before being used again after calling this function. If the arena consists of
+ *            more than a single block, the blocks are coalesced to a single block, so that
+ *            the same workload would fit in one block the next time around.
+ */
+extern void vec2_arena_reset(struct vec2_arena *arena_ptr);
+
+/**
+ * @brief   Releases all the memory held by an arena
+ *
+ * @param[in] arena_ptr  Pointer to an initialized arena structure.
+ *
+ * @note      This function must be called when there's no more use for the arena.
+ *            The arena can be used again afterwards without re-initialization.
+ */
+extern void vec2_arena_destroy(struct vec2_arena *arena_ptr);
+
+/**
+ * @brief   Initializes a large buffer allocator
+ *
+ * @param[in] mmap_ptr  Pointer to the allocator structure to initialize.
+ * @param[in] threshold The size in bytes from which buffers are mapped directly from the
+ *                      kernel. 0 to use a default threshold.
+ *
+ * @return    TRUE if the initialization succeeded.
+ *            FALSE otherwise.
+ */
+extern int vec2_mmap_init(struct vec2_mmap *mmap_ptr, size_t threshold);
+
+/**
+ * @brief   Makes a large buffer allocator back big buffers with transparent huge pages
+ *
+ * @param[in] mmap_ptr  Pointer to an initialized large buffer allocator structure.
+ * @param[in] threshold The size in bytes from which buffers are backed by huge pages.
+ *                      0 to disable huge pages.
+ *
+ * @note      Buffers that use huge pages are aligned to 2MB, so that the kernel can back every
+ *            whole 2MB of them with a huge page. Growing buffers in whole 2MB steps (e.g. using
+ *            <code>VEC2_GROWTH_PAGED</code>) leaves no tail of regular pages. The threshold is
+ *            raised to the mapping threshold of the allocator if it's lower. It can be changed
+ *            while buffers are mapped, and only affects buffers that are mapped or grown later.
+ *
+ * @return    TRUE if huge pages are supported and the threshold was set.
+ *            FALSE otherwise.
+ */
+extern int vec2_mmap_set_huge_pages(struct vec2_mmap *mmap_ptr, size_t threshold);
+
+/**
+ * @brief   Initializes a buffer cache
+ *
+ * @param[in] cache_ptr Pointer to the cache structure to initialize.
+ * @param[in] backing   Pointer to the allocator that the cached buffers come from.
+ *                      NULL to use the standard library's heap.
+ * @param[in] limit     The maximal total size in bytes of the cached buffers. 0 to use
+ *                      a default limit.
+ *
+ * @return    TRUE if the initialization succeeded.
+ *            FALSE otherwise.
+ */
+extern int vec2_cache_init(struct vec2_cache *cache_ptr, const struct vec2_allocator *backing, size_t limit);
+
+/**
+ * @brief   Returns all the buffers held by a buffer cache to its backing allocator
+ *
+ * @param[in] cache_ptr Pointer to an initialized cache structure.
+ *
+ * @note      This function must be called when there's no more use for the cache
+ *            (for the cache of a thread, before the thread exits).
+ */
+extern void vec2_cache_flush(struct vec2_cache *cache_ptr);
+
+/**
+ * @brief   Reads the counters of a buffer cache
+ *
+ * @param[in] cache_ptr   Pointer to an initialized cache structure.
+ * @param[out] hits_out   Optional pointer to store the number of allocations served from the cache.
+ * @param[out] misses_out Optional pointer to store the number of cacheable allocations that
+ *                        had to go to the backing allocator.
+ * @param[out] bytes_out  Optional pointer to store the total size in bytes of the cached buffers.
+ */
+extern void vec2_cache_stats(const struct vec2_cache *cache_ptr, size_t *hits_out, size_t *misses_out, size_t *bytes_out);
+
+/**
+ * @brief   Returns the buffer cache of the current thread
+ *
+ * @return    Pointer to the cache of the current thread.
+ *            NULL if the platform doesn't support thread local storage.
+ */
+extern struct vec2_cache *vec2_thread_cache(void);
+
+/**
+ * @brief   Returns the allocator that uses the buffer cache of the current thread
+ *
+ * @note      The allocator always works with the cache of the thread that calls it, so buffers
+ *            can be freed by threads other than the ones that allocated them. Its caches use
+ *            the standard library's heap with the default limit.
+ *
+ * @return    Pointer to the allocator.
+ *            NULL (i.e. the standard library's heap) if the platform doesn't support thread
+ *            local storage.
+ */
+extern const struct vec2_allocator *vec2_thread_cache_allocator(void);
+
 #ifdef __cplusplus
 } /* extern "C" { */
 #endif /* __cplusplus */
@@ -254,12 +935,132 @@ extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size
         size_t _idx[sizeof(type) / sizeof(type)]; \
         size_t _start; \
         type  *data; \
+        const struct vec2_allocator *_alloc; \
+        const struct vec2_growth    *_growth; \
+        unsigned int                 _flags; \
+    }
+
+/**
+ * Defines the body of a <code>vec</code> struct of type <code>type</code> that has room for
+ * <code>n</code> elements inside the struct itself, and only allocates memory once it grows
+ * beyond that.
+ */
+#define VEC2_BODY_INLINE(type, n) \
+    { \
+        size_t size; \
+        size_t capacity; \
+        size_t _idx[sizeof(type) / sizeof(type)]; \
+        size_t _start; \
+        type  *data; \
+        const struct vec2_allocator *_alloc; \
+        const struct vec2_growth    *_growth; \
+        unsigned int                 _flags; \
+        type                         _inline[n]; \
     }
 
 /**
  * Defines a static initializer for the <code>vec</code> struct defined using <code>VEC2_BODY</code>.
  */
-#define VEC2_INITIALIZER { 0, 0, { 0 }, 0, NULL }
+#define VEC2_INITIALIZER VEC2_INITIALIZER_WITH_ALLOCATOR(NULL)
+
+/**
+ * Defines a static initializer for the <code>vec</code> struct defined using <code>VEC2_BODY</code>
+ * that uses the allocator pointed to by <code>alloc_ptr</code> (or the standard library's heap
+ * if it's NULL).
+ */
+#define VEC2_INITIALIZER_WITH_ALLOCATOR(alloc_ptr) VEC2_INITIALIZER_EX(alloc_ptr, NULL, 0)
+
+/**
+ * Defines a static initializer for the <code>vec</code> struct defined using <code>VEC2_BODY</code>
+ * that uses the growth policy pointed to by <code>growth_ptr</code> (or the default policy if it's NULL).
+ */
+#define VEC2_INITIALIZER_WITH_GROWTH(growth_ptr) VEC2_INITIALIZER_EX(NULL, growth_ptr, 0)
+
+/**
+ * Defines a static initializer for the <code>vec</code> struct defined using <code>VEC2_BODY</code>
+ * whose data is always aligned to <code>alignment</code> bytes. <code>alignment</code> must be a
+ * constant power of two that is not greater than <code>VEC2_MAX_ALIGNMENT</code>.
+ */
+#define VEC2_INITIALIZER_ALIGNED(alignment) VEC2_INITIALIZER_EX(NULL, NULL, alignment)
+
+/**
+ * Defines a static initializer for the <code>vec</code> struct defined using <code>VEC2_BODY</code>
+ * that uses a specific allocator, growth policy, and alignment. The allocator and the growth
+ * policy can be NULL, and the alignment can be 0 to use the defaults. An alignment that isn't a
+ * power of two, or that is greater than <code>VEC2_MAX_ALIGNMENT</code>, fails to compile.
+ */
+#define VEC2_INITIALIZER_EX(alloc_ptr, growth_ptr, alignment) \
+    { 0, 0, { 0 }, 0, NULL, alloc_ptr, growth_ptr, \
+      (unsigned int)(_vec2_impl_log2(alignment) + _vec2_impl_check_alignment(alignment)) }
+
+/**
+ * Defines an initializer for the <code>vec</code> struct defined using <code>VEC2_BODY_INLINE</code>.
+ * Since the <code>vec</code> points into itself, the initializer is given the variable
+ * being initialized.
+ */
+#define VEC2_INITIALIZER_INLINE(vec) \
+    { 0, sizeof((vec)._inline) / sizeof(*(vec)._inline), { 0 }, 0, (vec)._inline, NULL, NULL, \
+      _VEC2_IMPL_FLAG_BORROWED, { 0 } }
+
+/**
+ * Defines a static initializer for the <code>vec</code> struct defined using <code>VEC2_BODY</code>
+ * that stores up to <code>capacity</code> elements in <code>buf</code>, and never allocates memory.
+ */
+#define VEC2_INITIALIZER_BUFFER(buf, capacity) \
+    { 0, capacity, { 0 }, 0, buf, NULL, NULL, _VEC2_IMPL_FLAG_BORROWED | _VEC2_IMPL_FLAG_FIXED }
+
+/**
+ * The maximal alignment of the data of a <code>vec</code>.
+ */
+#define VEC2_MAX_ALIGNMENT 32768
+
+/**
+ * Kinds of keys that <code>vec2_radix_sort</code> can sort by: unsigned integers, two's complement
+ * signed integers and IEEE 754 floating point numbers.
+ */
+#define VEC2_KEY_UNSIGNED 0
+#define VEC2_KEY_SIGNED 1
+#define VEC2_KEY_FLOAT 2
+
+/**
+ * Defines a static initializer for a geometric growth policy.
+ *
+ * @param[in] initial    The capacity of the first allocation.
+ * @param[in] factor_num The numerator of the growth factor.
+ * @param[in] factor_den The denominator of the growth factor.
+ */
+#define VEC2_GROWTH_GEOMETRIC(initial, factor_num, factor_den) \
+    { vec2_growth_geometric, initial, factor_num, factor_den, 0, NULL }
+
+/**
+ * Defines a static initializer for a geometric growth policy that rounds the buffer up to whole pages.
+ *
+ * @param[in] initial    The minimal capacity of the first allocation.
+ * @param[in] factor_num The numerator of the growth factor.
+ * @param[in] factor_den The denominator of the growth factor.
+ * @param[in] page_size  The size in bytes to round the buffer up to.
+ */
+#define VEC2_GROWTH_PAGED(initial, factor_num, factor_den, page_size) \
+    { vec2_growth_paged, initial, factor_num, factor_den, page_size, NULL }
+
+/**
+ * Defines a static initializer for a growth policy that grows in fixed-size chunks.
+ *
+ * @param[in] initial   The capacity of the first allocation.
+ * @param[in] chunk     The amount of elements to grow by.
+ */
+#define VEC2_GROWTH_CHUNKED(initial, chunk) \
+    { vec2_growth_chunked, initial, 1, 1, chunk, NULL }
+
+/**
+ * Defines a static initializer for a custom growth policy.
+ *
+ * @param[in] next_capacity_fn The function that computes the next capacity.
+ * @param[in] initial          The smallest capacity to shrink to.
+ * @param[in] ctx              User context, available to the function through the policy.
+ */
+#define VEC2_GROWTH_CUSTOM(next_capacity_fn, initial, ctx) \
+    { next_capacity_fn, initial, 1, 1, 0, ctx }
 
 /**
  * @brief   Initializes a <code>vec</code>
@@ -270,7 +1071,138 @@ extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size
  *            FALSE otherwise.
  */
 #define vec2_init(vec_ptr) \
-    (_vec2_impl_init)((struct _vec2_impl_struct *)(vec_ptr))
+    vec2_init_with_allocator(vec_ptr, NULL)
+
+/**
+ * @brief   Initializes a <code>vec</code> that uses a specific allocator
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] alloc_ptr Pointer to the allocator to use. NULL to use the standard library's heap.
+ *
+ * @note      The allocator must outlive the <code>vec</code>.
+ *
+ * @return    TRUE if the initialization succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_init_with_allocator(vec_ptr, alloc_ptr) \
+    vec2_init_ex(vec_ptr, alloc_ptr, NULL, 0)
+
+/**
+ * @brief   Initializes a <code>vec</code> whose data is always aligned
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] alignment The alignment in bytes of the data. Must be a power of two
+ *                      that is not greater than <code>VEC2_MAX_ALIGNMENT</code>.
+ *
+ * @note      The alignment is maintained across all the operations on the <code>vec</code>.
+ *            Removing elements from the beginning of the <code>vec</code> might need to move
+ *            the rest of the elements in order to do so.
+ *
+ * @return    TRUE if the initialization succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_init_aligned(vec_ptr, alignment) \
+    vec2_init_ex(vec_ptr, NULL, NULL, alignment)
+
+/**
+ * @brief   Initializes a <code>vec</code> that uses a specific allocator, growth policy, and alignment
+ *
+ * @param[in] vec_ptr    Pointer to a <code>vec</code> structure.
+ * @param[in] alloc_ptr  Pointer to the allocator to use. NULL to use the standard library's heap.
+ * @param[in] growth_ptr Pointer to the growth policy to use. NULL to use the default policy.
+ * @param[in] alignment  The alignment in bytes of the data. 0 for the default alignment.
+ *
+ * @note      Both the allocator and the growth policy must outlive the <code>vec</code>.
+ *
+ * @return    TRUE if the initialization succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_init_ex(vec_ptr, alloc_ptr, growth_ptr, alignment) \
+    (_vec2_impl_init)((struct _vec2_impl_struct *)(vec_ptr), alloc_ptr, growth_ptr, alignment)
+
+/**
+ * @brief   Initializes a <code>vec</code> defined using <code>VEC2_BODY_INLINE</code>
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ *
+ * @note      The <code>vec</code> stores its elements inside the struct until they no longer
+ *            fit, at which point they are moved to a heap buffer that's used from then on.
+ *            Clearing a <code>vec</code> that didn't spill keeps its inline storage, but once
+ *            it spilled it must be re-initialized to use the inline storage again.
+ *            A <code>vec</code> that uses its inline storage must not be copied by value.
+ *
+ * @return    TRUE if the initialization succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_init_inline(vec_ptr) \
+    (_vec2_impl_init_buffer)((struct _vec2_impl_struct *)(vec_ptr), \
+        (vec_ptr)->_inline, sizeof((vec_ptr)->_inline) / sizeof(*(vec_ptr)->_inline), FALSE)
+
+/**
+ * @brief   Initializes a fixed capacity <code>vec</code> over a caller provided buffer
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] buf       Pointer to the buffer to store the elements in.
+ * @param[in] capacity  The number of elements that fit in @p buf.
+ *
+ * @note      The <code>vec</code> never allocates or frees memory. Operations that would
+ *            need more than @p capacity elements fail instead, and clearing the
+ *            <code>vec</code> only empties it. @p buf must outlive the <code>vec</code>.
+ *
+ * @return    TRUE if the initialization succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_init_buffer(vec_ptr, buf, capacity) \
+    ((void)sizeof((vec_ptr)->data = (buf)), /* Type-safety enforcement */ \
+        (_vec2_impl_init_buffer)((struct _vec2_impl_struct *)(vec_ptr), buf, capacity, TRUE))
+
+/**
+ * @brief   Changes the growth policy of a <code>vec</code>
+ *
+ * @param[in] vec_ptr    Pointer to a <code>vec</code> structure.
+ * @param[in] growth_ptr Pointer to the growth policy to use. NULL to use the default policy.
+ *
+ * @note      @p growth_ptr must be an expression that is free from side effects.
+ *
+ * @return    TRUE if the policy was changed.
+ *            FALSE otherwise.
+ */
+#define vec2_set_growth(vec_ptr, growth_ptr) \
+    (_vec2_impl_valid(vec_ptr) && \
+        (((growth_ptr) == NULL) || ((growth_ptr)->next_capacity != NULL)) && \
+        ((vec_ptr)->_growth = (growth_ptr), TRUE))
+
+/**
+ * @brief   Gets the allocator of an arena
+ *
+ * @param[in] arena_ptr Pointer to an initialized arena structure.
+ *
+ * @return    Pointer to an allocator that can be used with <code>vec2_init_with_allocator</code>
+ *            and <code>VEC2_INITIALIZER_WITH_ALLOCATOR</code>.
+ */
+#define vec2_arena_allocator(arena_ptr) \
+    ((const struct vec2_allocator *)&(arena_ptr)->_allocator)
+
+/**
+ * @brief   Gets the allocator of a large buffer allocator
+ *
+ * @param[in] mmap_ptr  Pointer to an initialized large buffer allocator structure.
+ *
+ * @return    Pointer to an allocator that can be used with <code>vec2_init_with_allocator</code>
+ *            and <code>VEC2_INITIALIZER_WITH_ALLOCATOR</code>.
+ */
+#define vec2_mmap_allocator(mmap_ptr) \
+    ((const struct vec2_allocator *)&(mmap_ptr)->_allocator)
+
+/**
+ * @brief   Returns the allocator that allocates memory through a buffer cache
+ *
+ * @param[in] cache_ptr Pointer to an initialized cache structure.
+ *
+ * @return    Pointer to the allocator.
+ */
+#define vec2_cache_allocator(cache_ptr) \
+    ((const struct vec2_allocator *)&(cache_ptr)->_allocator)
 
 /**
  * @brief   Reserves additional memory in a <code>vec</code>
@@ -295,6 +1227,38 @@ extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size
 #define vec2_shrink_to_fit(vec_ptr) \
     (_vec2_impl_shrink)((struct _vec2_impl_struct *)(vec_ptr), sizeof(*vec2_data(vec_ptr)))
 
+/**
+ * @brief   Changes the number of elements in a <code>vec</code>, leaving new elements uninitialized
+ *
+ * @param[in] vec_ptr    Pointer to a <code>vec</code> structure.
+ * @param[in] new_size   The new number of elements.
+ *
+ * @note      Elements past @p new_size are removed. The contents of the elements that are
+ *            added are undefined, and it's up to the caller to write them.
+ *
+ * @return    TRUE if the resizing succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_resize(vec_ptr, new_size) \
+    (_vec2_impl_resize)((struct _vec2_impl_struct *)(vec_ptr), new_size, FALSE, sizeof(*vec2_data(vec_ptr)))
+
+/**
+ * @brief   Changes the number of elements in a <code>vec</code>, zero-filling new elements
+ *
+ * @param[in] vec_ptr    Pointer to a <code>vec</code> structure.
+ * @param[in] new_size   The new number of elements.
+ *
+ * @note      Elements past @p new_size are removed. When the <code>vec</code> is empty and
+ *            needs a bigger buffer, its buffer is replaced by a zeroed one from the allocator
+ *            (e.g. using <code>calloc</code>, or fresh pages from the large buffer allocator),
+ *            so that big buffers don't have to be cleared explicitly.
+ *
+ * @return    TRUE if the resizing succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_resize_zeroed(vec_ptr, new_size) \
+    (_vec2_impl_resize)((struct _vec2_impl_struct *)(vec_ptr), new_size, TRUE, sizeof(*vec2_data(vec_ptr)))
+
 /**
  * @brief   Gets the amount of elements stored in a <code>vec</code>
  *
@@ -409,6 +1373,33 @@ extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size
     (_vec2_impl_swap)((struct _vec2_impl_struct *)(vec_ptr), \
         first, second, sizeof(*vec2_data(vec_ptr)))
 
+/**
+ * @brief   Reverses the order of the elements in a <code>vec</code>
+ *
+ * @param[in]  vec_ptr  Pointer to a <code>vec</code> structure.
+ *
+ * @return     TRUE if the reversal suceeded.
+ *             FALSE otherwise.
+ */
+#define vec2_reverse(vec_ptr) \
+    (_vec2_impl_reverse)((struct _vec2_impl_struct *)(vec_ptr), \
+        sizeof(*vec2_data(vec_ptr)))
+
+/**
+ * @brief   Rotates the elements in a <code>vec</code> to the left
+ *
+ * @param[in]  vec_ptr  Pointer to a <code>vec</code> structure.
+ * @param[in]  shift    The amount of positions to rotate the elements by, so that the element
+ *                      at index @p shift becomes the first one. Rotating to the right by
+ *                      @c n is rotating to the left by <code>vec2_size(vec_ptr) - n</code>.
+ *
+ * @return     TRUE if the rotation suceeded.
+ *             FALSE otherwise.
+ */
+#define vec2_rotate(vec_ptr, shift) \
+    (_vec2_impl_rotate)((struct _vec2_impl_struct *)(vec_ptr), \
+        shift, sizeof(*vec2_data(vec_ptr)))
+
 /**
  * @brief   Sorts a <code>vec</code>
  *
@@ -423,6 +1414,498 @@ extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size
         (_vec2_impl_sort)((struct _vec2_impl_struct *)(vec_ptr), \
             (_vec2_impl_cmpfn)cmpfn, sizeof(*vec2_data(vec_ptr))))
 
+/**
+ * @brief   Sorts a <code>vec</code> while keeping the order of equal elements
+ *
+ * @param[in]  vec_ptr  Pointer to a <code>vec</code> structure.
+ * @param[in]  cmpfn    Pointer to comparer function for type <code>type</code>.
+ *
+ * @note      The sort is an adaptive merge sort that finds the runs of elements that are already
+ *            in order (or in strictly reverse order), so sorting mostly sorted elements takes close
+ *            to linear time. Merging takes scratch space for up to half of the elements, which is
+ *            allocated from the standard library's heap only if needed, and freed before returning.
+ *
+ * @return    TRUE if the sort succeeded.
+ *            FALSE otherwise, in which case the elements are left in an unspecified order.
+ */
+#define vec2_stable_sort(vec_ptr, cmpfn) \
+    vec2_stable_sort_scratch(vec_ptr, cmpfn, NULL)
+
+/**
+ * @brief   Sorts a <code>vec</code> while keeping the order of equal elements, using a scratch <code>vec</code>
+ *
+ * @param[in]  vec_ptr      Pointer to a <code>vec</code> structure.
+ * @param[in]  cmpfn        Pointer to comparer function for type <code>type</code>.
+ * @param[in]  scratch_ptr  Optional pointer to a <code>vec</code> structure of the same type to use
+ *                          as scratch space.
+ *
+ * @note      The scratch <code>vec</code> is left empty, but keeps its capacity, so it can be
+ *            reused without allocating memory.
+ *
+ * @return    TRUE if the sort succeeded.
+ *            FALSE otherwise, in which case the elements are left in an unspecified order.
+ */
+#define vec2_stable_sort_scratch(vec_ptr, cmpfn, scratch_ptr) \
+    ((void)sizeof(cmpfn(vec2_data(vec_ptr), vec2_data(vec_ptr))), /* Type-safety enforcement */ \
+     (void)sizeof((vec_ptr) == (scratch_ptr)), \
+        (_vec2_impl_stable_sort)((struct _vec2_impl_struct *)(vec_ptr), (_vec2_impl_cmpfn)cmpfn, \
+            (struct _vec2_impl_struct *)(scratch_ptr), sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * @brief   Sorts a <code>vec</code> using multiple threads
+ *
+ * @param[in]  vec_ptr       Pointer to a <code>vec</code> structure.
+ * @param[in]  cmpfn         Pointer to comparer function for type <code>type</code>.
+ * @param[in]  thread_count  The maximal number of threads to use (up to 64), or 0 to use as
+ *                           many threads as there are online CPUs.
+ *
+ * @note      Each thread sorts a chunk of at least 16K elements using <code>qsort</code>, and
+ *            then the chunks are merged in parallel. Smaller <code>vec</code>s, and builds without
+ *            POSIX threads (or with <code>VEC2_NO_THREADS</code> defined), sort on the calling
+ *            thread like <code>vec2_sort</code>. @p cmpfn must be safe to call from multiple
+ *            threads at once. The merges use a copy of the elements that is allocated from the
+ *            standard library's heap and freed before returning.
+ *
+ * @return    TRUE if the sort succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_parallel_sort(vec_ptr, cmpfn, thread_count) \
+    ((void)sizeof(cmpfn(vec2_data(vec_ptr), vec2_data(vec_ptr))), /* Type-safety enforcement */ \
+        (_vec2_impl_parallel_sort)((struct _vec2_impl_struct *)(vec_ptr), \
+            (_vec2_impl_cmpfn)cmpfn, thread_count, sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * @brief   Sorts a <code>vec</code> of numbers using radix sort
+ *
+ * @param[in]  vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in]  kind      The kind of the elements: <code>VEC2_KEY_UNSIGNED</code>,
+ *                       <code>VEC2_KEY_SIGNED</code> or <code>VEC2_KEY_FLOAT</code>.
+ *
+ * @note      The elements must be integers of up to 8 bytes, or a <code>float</code> or a
+ *            <code>double</code>. Scratch space for a copy of the elements is allocated from
+ *            the standard library's heap and freed before returning.
+ *
+ * @return    TRUE if the sort succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_radix_sort(vec_ptr, kind) \
+    vec2_radix_sort_key(vec_ptr, kind, 0, sizeof(*vec2_data(vec_ptr)), NULL)
+
+/**
+ * @brief   Sorts a <code>vec</code> of numbers using radix sort and a scratch <code>vec</code>
+ *
+ * @param[in]  vec_ptr      Pointer to a <code>vec</code> structure.
+ * @param[in]  kind         The kind of the elements: <code>VEC2_KEY_UNSIGNED</code>,
+ *                          <code>VEC2_KEY_SIGNED</code> or <code>VEC2_KEY_FLOAT</code>.
+ * @param[in]  scratch_ptr  Pointer to a <code>vec</code> structure of the same type to use as
+ *                          scratch space.
+ *
+ * @note      The scratch <code>vec</code> is left empty, but keeps its capacity, so it can be
+ *            reused without allocating memory. Its buffer may be traded with the buffer of the
+ *            sorted <code>vec</code>. If it can't hold a copy of the elements and can't grow
+ *            (e.g. if it has a fixed capacity), the sort fails and it's left untouched.
+ *
+ * @return    TRUE if the sort succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_radix_sort_scratch(vec_ptr, kind, scratch_ptr) \
+    vec2_radix_sort_key(vec_ptr, kind, 0, sizeof(*vec2_data(vec_ptr)), scratch_ptr)
+
+/**
+ * @brief   Sorts a <code>vec</code> by a numeric key embedded in its elements using radix sort
+ *
+ * @param[in]  vec_ptr      Pointer to a <code>vec</code> structure.
+ * @param[in]  kind         The kind of the key: <code>VEC2_KEY_UNSIGNED</code>,
+ *                          <code>VEC2_KEY_SIGNED</code> or <code>VEC2_KEY_FLOAT</code>.
+ * @param[in]  key_offset   The offset of the key in an element (e.g. using <code>offsetof</code>).
+ * @param[in]  key_size     The size of the key, up to 8 bytes.
+ * @param[in]  scratch_ptr  Optional pointer to a <code>vec</code> structure of the same type to
+ *                          use as scratch space.
+ *
+ * @note      The sort is stable, and takes a pass over the elements for every byte of the key
+ *            that isn't the same in all of them.
+ *
+ * @return    TRUE if the sort succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_radix_sort_key(vec_ptr, kind, key_offset, key_size, scratch_ptr) \
+    ((void)sizeof((vec_ptr) == (scratch_ptr)), /* Type-safety enforcement */ \
+     (_vec2_impl_radix_sort)((struct _vec2_impl_struct *)(vec_ptr), kind, key_offset, key_size, \
+        (struct _vec2_impl_struct *)(scratch_ptr), sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * Defines a function named <code>name</code> that sorts a <code>vec</code> of type
+ * <code>vec_type</code> (e.g. <code>struct int_vec</code>) whose elements are of type
+ * <code>el_type</code> (e.g. <code>int</code>).
+ *
+ * <code>less</code> is a function or a function-like macro that receives two pointers to elements,
+ * and evaluates to non-zero if the first element should be ordered before the second one. Since
+ * it's known at compile time, it can be inlined into the sort, and elements are moved using
+ * typed assignments. The defined function has the signature <code>int name(vec_type *vec_ptr)</code>,
+ * and behaves like <code>vec2_sort</code>.
+ *
+ * The sort is an introsort: a quicksort with a median of three pivot that falls back to heapsort
+ * when the partitions get too unbalanced, and to insertion sort for small partitions. It is not
+ * stable.
+ */
+#define VEC2_DEFINE_SORT(name, vec_type, el_type, less) \
+    static void _vec2_impl_sort_##name##_swap(el_type *first, el_type *second) \
+    { \
+        el_type tmp = *first; \
+        *first = *second; \
+        *second = tmp; \
+    } \
+    \
+    static void _vec2_impl_sort_##name##_insertion(el_type *arr, size_t len) \
+    { \
+        size_t i, j; \
+        \
+        for (i = 1; i < len; ++i) \
+        { \
+            el_type tmp = arr[i]; \
+            \
+            for (j = i; (j > 0) && less(&tmp, &arr[j - 1]); --j) \
+            { \
+                arr[j] = arr[j - 1]; \
+            } \
+            \
+            arr[j] = tmp; \
+        } \
+    } \
+    \
+    static void _vec2_impl_sort_##name##_sift_down(el_type *arr, size_t root, size_t len) \
+    { \
+        el_type tmp = arr[root]; \
+        size_t child; \
+        \
+        while ((child = (2 * root) + 1) < len) \
+        { \
+            if ((child + 1 < len) && less(&arr[child], &arr[child + 1])) \
+            { \
+                ++child; \
+            } \
+            \
+            if (!less(&tmp, &arr[child])) \
+            { \
+                break; \
+            } \
+            \
+            arr[root] = arr[child]; \
+            root = child; \
+        } \
+        \
+        arr[root] = tmp; \
+    } \
+    \
+    static void _vec2_impl_sort_##name##_heap(el_type *arr, size_t len) \
+    { \
+        size_t i; \
+        \
+        for (i = len / 2; i > 0; --i) \
+        { \
+            _vec2_impl_sort_##name##_sift_down(arr, i - 1, len); \
+        } \
+        \
+        for (i = len - 1; i > 0; --i) \
+        { \
+            _vec2_impl_sort_##name##_swap(&arr[0], &arr[i]); \
+            _vec2_impl_sort_##name##_sift_down(arr, 0, i); \
+        } \
+    } \
+    \
+    static void _vec2_impl_sort_##name##_intro(el_type *arr, size_t len, size_t depth) \
+    { \
+        while (len > _VEC2_IMPL_SORT_THRESHOLD) \
+        { \
+            el_type pivot; \
+            size_t i = 0, j = len - 1, mid = len / 2; \
+            \
+            /* Too many unbalanced partitions, so guarantee O(n log n) */ \
+            if (depth-- == 0) \
+            { \
+                _vec2_impl_sort_##name##_heap(arr, len); \
+                return; \
+            } \
+            \
+            /* Order the first, middle and last elements, so that the first and last ones stop \
+             * the scans below without bounds checks */ \
+            if (less(&arr[mid], &arr[0])) \
+            { \
+                _vec2_impl_sort_##name##_swap(&arr[mid], &arr[0]); \
+            } \
+            \
+            if (less(&arr[j], &arr[mid])) \
+            { \
+                _vec2_impl_sort_##name##_swap(&arr[j], &arr[mid]); \
+                \
+                if (less(&arr[mid], &arr[0])) \
+                { \
+                    _vec2_impl_sort_##name##_swap(&arr[mid], &arr[0]); \
+                } \
+            } \
+            \
+            pivot = arr[mid]; \
+            \
+            for (;;) \
+            { \
+                while (less(&arr[i], &pivot)) \
+                { \
+                    ++i; \
+                } \
+                \
+                while (less(&pivot, &arr[j])) \
+                { \
+                    --j; \
+                } \
+                \
+                if (i >= j) \
+                { \
+                    break; \
+                } \
+                \
+                _vec2_impl_sort_##name##_swap(&arr[i], &arr[j]); \
+                ++i; \
+                --j; \
+            } \
+            \
+            /* Recurse into the smaller partition and loop over the bigger one to bound the stack */ \
+            if (i < len - i) \
+            { \
+                _vec2_impl_sort_##name##_intro(arr, i, depth); \
+                arr += i; \
+                len -= i; \
+            } \
+            else \
+            { \
+                _vec2_impl_sort_##name##_intro(arr + i, len - i, depth); \
+                len = i; \
+            } \
+        } \
+        \
+        _vec2_impl_sort_##name##_insertion(arr, len); \
+    } \
+    \
+    static int name(vec_type *vec_ptr) \
+    { \
+        size_t depth = 0, len; \
+        \
+        if (!_vec2_impl_valid(vec_ptr)) \
+        { \
+            return FALSE; \
+        } \
+        \
+        for (len = vec2_size(vec_ptr); len > 1; len >>= 1) \
+        { \
+            depth += 2; \
+        } \
+        \
+        _vec2_impl_sort_##name##_intro(vec2_data(vec_ptr), vec2_size(vec_ptr), depth); \
+        return TRUE; \
+    }
+
+/**
+ * @brief   Finds the first element in a sorted <code>vec</code> that isn't ordered before a key
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] key_ptr   Pointer to the key.
+ * @param[in] cmpfn     Pointer to comparer function for type <code>type</code>. It's called with a
+ *                      pointer to an element and <code>key_ptr</code>, in that order.
+ *
+ * @return     The index of the element, or the size of the <code>vec</code> if all of the elements
+ *             are ordered before the key. 0 if the <code>vec</code> isn't valid.
+ */
+#define vec2_lower_bound(vec_ptr, key_ptr, cmpfn) \
+    ((void)sizeof(cmpfn(vec2_data(vec_ptr), key_ptr)), /* Type-safety enforcement */ \
+        (_vec2_impl_bound)((struct _vec2_impl_struct *)(vec_ptr), (const void *)(key_ptr), \
+            (_vec2_impl_cmpfn)cmpfn, FALSE, sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * @brief   Finds the first element in a sorted <code>vec</code> that is ordered after a key
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] key_ptr   Pointer to the key.
+ * @param[in] cmpfn     Pointer to comparer function for type <code>type</code>. It's called with a
+ *                      pointer to an element and <code>key_ptr</code>, in that order.
+ *
+ * @return     The index of the element, or the size of the <code>vec</code> if none of the elements
+ *             are ordered after the key. 0 if the <code>vec</code> isn't valid.
+ */
+#define vec2_upper_bound(vec_ptr, key_ptr, cmpfn) \
+    ((void)sizeof(cmpfn(vec2_data(vec_ptr), key_ptr)), /* Type-safety enforcement */ \
+        (_vec2_impl_bound)((struct _vec2_impl_struct *)(vec_ptr), (const void *)(key_ptr), \
+            (_vec2_impl_cmpfn)cmpfn, TRUE, sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * @brief   Finds the range of elements in a sorted <code>vec</code> that are equal to a key
+ *
+ * @param[in]  vec_ptr    Pointer to a <code>vec</code> structure.
+ * @param[in]  key_ptr    Pointer to the key.
+ * @param[in]  cmpfn      Pointer to comparer function for type <code>type</code>. It's called with
+ *                        a pointer to an element and <code>key_ptr</code>, in that order.
+ * @param[out] first_out  Optional pointer to a <code>size_t</code> that receives the index of the
+ *                        first equal element.
+ * @param[out] last_out   Optional pointer to a <code>size_t</code> that receives the index past the
+ *                        last equal element.
+ *
+ * @note      If there are no equal elements, both indices are where the key could be inserted.
+ *
+ * @return    TRUE if the search succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_equal_range(vec_ptr, key_ptr, cmpfn, first_out, last_out) \
+    ((void)sizeof(cmpfn(vec2_data(vec_ptr), key_ptr)), /* Type-safety enforcement */ \
+        (_vec2_impl_equal_range)((struct _vec2_impl_struct *)(vec_ptr), (const void *)(key_ptr), \
+            (_vec2_impl_cmpfn)cmpfn, first_out, last_out, sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * @brief   Builds a search index from a sorted <code>vec</code> by copying its elements in Eytzinger order
+ *
+ * @param[in] dst_ptr   Pointer to a <code>vec</code> structure to copy the elements to. Its elements
+ *                      are replaced.
+ * @param[in] src_ptr   Pointer to a sorted <code>vec</code> structure of the same type.
+ *
+ * @note      The Eytzinger order lays out the implicit binary search tree of the elements level by
+ *            level, so the first steps of every search read the same few cache lines, and the
+ *            descendants of a node a few levels down are adjacent and can be prefetched.
+ *
+ * @return    TRUE if the index was built.
+ *            FALSE otherwise, in which case <code>dst_ptr</code> may be left empty.
+ */
+#define vec2_eytzinger_build(dst_ptr, src_ptr) \
+    ((void)sizeof((dst_ptr) == (src_ptr)), /* Type-safety enforcement */ \
+        (_vec2_impl_eytzinger_build)((struct _vec2_impl_struct *)(dst_ptr), \
+            (const struct _vec2_impl_struct *)(src_ptr), sizeof(*vec2_data(dst_ptr))))
+
+/**
+ * @brief   Finds the first element in a <code>vec</code> in Eytzinger order that isn't ordered before a key
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure built by <code>vec2_eytzinger_build</code>.
+ * @param[in] key_ptr   Pointer to the key.
+ * @param[in] cmpfn     Pointer to comparer function for type <code>type</code>. It's called with a
+ *                      pointer to an element and <code>key_ptr</code>, in that order.
+ *
+ * @return     The index of the element in the <code>vec</code>, or its size if all of the elements
+ *             are ordered before the key. 0 if the <code>vec</code> isn't valid.
+ */
+#define vec2_eytzinger_search(vec_ptr, key_ptr, cmpfn) \
+    ((void)sizeof(cmpfn(vec2_data(vec_ptr), key_ptr)), /* Type-safety enforcement */ \
+        (_vec2_impl_eytzinger_search)((struct _vec2_impl_struct *)(vec_ptr), (const void *)(key_ptr), \
+            (_vec2_impl_cmpfn)cmpfn, sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * @internal
+ * Defines the body of a binary search over a sorted array of <code>el_type</code> that finds the
+ * first element that isn't ordered before <code>*key_ptr</code>, or that is ordered after it if
+ * <code>upper</code> is non-zero. The range is halved without branching on the comparison, so
+ * compilers can use conditional moves for scalar keys, and there are no mispredictions.
+ */
+#define _VEC2_IMPL_DEFINE_BOUND(name, vec_type, el_type, less, upper) \
+    static size_t name(vec_type *vec_ptr, const el_type *key_ptr) \
+    { \
+        const el_type *base; \
+        size_t len, half; \
+        \
+        if (!_vec2_impl_valid(vec_ptr) || !vec2_size(vec_ptr)) \
+        { \
+            return 0; \
+        } \
+        \
+        base = vec2_data(vec_ptr); \
+        \
+        for (len = vec2_size(vec_ptr); len > 1; len -= half) \
+        { \
+            half = len / 2; \
+            base += ((upper) ? !less(key_ptr, &base[half]) : less(&base[half], key_ptr)) ? half : 0; \
+        } \
+        \
+        return (size_t)(base - vec2_data(vec_ptr)) + \
+            (((upper) ? !less(key_ptr, base) : less(base, key_ptr)) ? 1 : 0); \
+    }
+
+/**
+ * Defines a function named <code>name</code> that behaves like <code>vec2_lower_bound</code> for a
+ * <code>vec</code> of type <code>vec_type</code> whose elements are of type <code>el_type</code>.
+ *
+ * <code>less</code> is a function or a function-like macro like the one passed to
+ * <code>VEC2_DEFINE_SORT</code>, so the same one can be used to sort the <code>vec</code> and to
+ * search it. The defined function has the signature
+ * <code>size_t name(vec_type *vec_ptr, const el_type *key_ptr)</code>. It doesn't branch on the
+ * comparisons, which makes it faster than <code>vec2_lower_bound</code> for scalar keys.
+ */
+#define VEC2_DEFINE_LOWER_BOUND(name, vec_type, el_type, less) \
+    _VEC2_IMPL_DEFINE_BOUND(name, vec_type, el_type, less, 0)
+
+/**
+ * Defines a function named <code>name</code> that behaves like <code>vec2_upper_bound</code>, the
+ * same way <code>VEC2_DEFINE_LOWER_BOUND</code> does for <code>vec2_lower_bound</code>.
+ */
+#define VEC2_DEFINE_UPPER_BOUND(name, vec_type, el_type, less) \
+    _VEC2_IMPL_DEFINE_BOUND(name, vec_type, el_type, less, 1)
+
+/**
+ * Defines a function named <code>name</code> that behaves like <code>vec2_equal_range</code>, the
+ * same way <code>VEC2_DEFINE_LOWER_BOUND</code> does for <code>vec2_lower_bound</code>. The defined
+ * function has the signature
+ * <code>int name(vec_type *vec_ptr, const el_type *key_ptr, size_t *first_out, size_t *last_out)</code>.
+ */
+#define VEC2_DEFINE_EQUAL_RANGE(name, vec_type, el_type, less) \
+    _VEC2_IMPL_DEFINE_BOUND(_vec2_impl_search_##name##_lower, vec_type, el_type, less, 0) \
+    _VEC2_IMPL_DEFINE_BOUND(_vec2_impl_search_##name##_upper, vec_type, el_type, less, 1) \
+    \
+    static int name(vec_type *vec_ptr, const el_type *key_ptr, size_t *first_out, size_t *last_out) \
+    { \
+        if (!_vec2_impl_valid(vec_ptr)) \
+        { \
+            return FALSE; \
+        } \
+        \
+        if (first_out != NULL) \
+        { \
+            *first_out = _vec2_impl_search_##name##_lower(vec_ptr, key_ptr); \
+        } \
+        \
+        if (last_out != NULL) \
+        { \
+            *last_out = _vec2_impl_search_##name##_upper(vec_ptr, key_ptr); \
+        } \
+        \
+        return TRUE; \
+    }
+
+/**
+ * Defines a function named <code>name</code> that behaves like <code>vec2_eytzinger_search</code>,
+ * the same way <code>VEC2_DEFINE_LOWER_BOUND</code> does for <code>vec2_lower_bound</code>. The
+ * defined function has the signature <code>size_t name(vec_type *vec_ptr, const el_type *key_ptr)</code>.
+ */
+#define VEC2_DEFINE_EYTZINGER_SEARCH(name, vec_type, el_type, less) \
+    static size_t name(vec_type *vec_ptr, const el_type *key_ptr) \
+    { \
+        const el_type *base; \
+        size_t len, node = 1; \
+        \
+        if (!_vec2_impl_valid(vec_ptr)) \
+        { \
+            return 0; \
+        } \
+        \
+        base = vec2_data(vec_ptr); \
+        len = vec2_size(vec_ptr); \
+        \
+        /* Node k (counting from 1) has the children 2k and 2k + 1 */ \
+        while (node <= len) \
+        { \
+            if (node <= len / _vec2_impl_prefetch_span(sizeof(el_type))) \
+            { \
+                _vec2_impl_prefetch(&base[(node * _vec2_impl_prefetch_span(sizeof(el_type))) - 1]); \
+            } \
+            \
+            node = (2 * node) + (less(&base[node - 1], key_ptr) ? 1 : 0); \
+        } \
+        \
+        node = _vec2_impl_eytzinger_node(node); \
+        return node ? node - 1 : len; \
+    }
+
 /**
  * @brief   Removes an element from the end of a <code>vec</code>
  *
@@ -517,6 +2000,51 @@ extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size
      (_vec2_impl_insert)((struct _vec2_impl_struct *)(vec_ptr), \
         idx, val, len, sizeof(*vec2_data(vec_ptr))))
 
+/**
+ * @brief   Replaces a range of elements in a <code>vec</code> with other elements
+ *
+ * @param[in]  vec_ptr     Pointer to a <code>vec</code> structure.
+ * @param[in]  idx         The index of the first element to replace.
+ * @param[in]  remove_len  The amount of elements to remove from @p idx.
+ * @param[in]  val         The array of elements to insert at @p idx.
+ * @param[in]  insert_len  The amount of elements to insert.
+ * @param[out] out         Optional pointer to an array of @p remove_len elements to store
+ *                         the removed elements in.
+ *
+ * @note      The elements after the range are moved at most once, and when the range is
+ *            closer to the beginning of the <code>vec</code>, the elements before it are moved
+ *            into the free space at the beginning instead.
+ *
+ * @return    TRUE if the replacement succeeded.
+ *            FALSE otherwise, in which case the <code>vec</code> is left unchanged.
+ */
+#define vec2_splice(vec_ptr, idx, remove_len, val, insert_len, out) \
+    ((void)sizeof(*vec2_data(vec_ptr) = (val)[0]), /* Type-safety enforcement */ \
+     (void)sizeof(vec2_data(vec_ptr) == (out)), \
+     (_vec2_impl_splice)((struct _vec2_impl_struct *)(vec_ptr), \
+        idx, remove_len, val, insert_len, sizeof(*vec2_data(vec_ptr)), out))
+
+/**
+ * @brief   Inserts multiple elements at different indices in a <code>vec</code> at once
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] idx_arr   Pointer to an array of the indices at which to insert the elements, sorted in
+ *                      ascending order. Each index refers to a position in the <code>vec</code> as it
+ *                      is before the insertion, and elements with equal indices are inserted in order.
+ * @param[in] val       The array of elements to insert, one for each index in @p idx_arr.
+ * @param[in] count     The amount of elements to insert.
+ *
+ * @note      The <code>vec</code> grows at most once and every existing element is moved at most
+ *            once, regardless of the amount of indices.
+ *
+ * @return    TRUE if the insertion succeeded.
+ *            FALSE otherwise, in which case the <code>vec</code> is left unchanged.
+ */
+#define vec2_insert_indices(vec_ptr, idx_arr, val, count) \
+    ((void)sizeof(*vec2_data(vec_ptr) = (val)[0]), /* Type-safety enforcement */ \
+     (_vec2_impl_insert_indices)((struct _vec2_impl_struct *)(vec_ptr), \
+        idx_arr, val, count, sizeof(*vec2_data(vec_ptr))))
+
 /**
  * @brief   Assigns a value to an element in a <code>vec</code>
  *
@@ -570,6 +2098,40 @@ extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size
      (_vec2_impl_assign)((struct _vec2_impl_struct *)(vec_ptr), \
         idx, val, len, sizeof(*vec2_data(vec_ptr))))
 
+/**
+ * @brief   Assigns the same value to a range of existing slots in a <code>vec</code>
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] idx       The index of the first slot to assign the value to.
+ * @param[in] len       The amount of slots to assign the value to.
+ * @param[in] val       Pointer to the value to assign.
+ *
+ * @note      @p idx and @p len are valid only if the range [idx, idx + len) fits
+ *            in [0, vec2_size(vec_ptr)).
+ *
+ * @return    TRUE if the assignment succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_fill(vec_ptr, idx, len, val) \
+    ((void)sizeof(*vec2_data(vec_ptr) = (val)[0]), /* Type-safety enforcement */ \
+     (_vec2_impl_fill)((struct _vec2_impl_struct *)(vec_ptr), \
+        idx, len, val, sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * @brief   Pushes multiple copies of a value to the end of a <code>vec</code>
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] val       Pointer to the value to push.
+ * @param[in] len       The amount of copies to push.
+ *
+ * @return    TRUE if the push succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_push_repeat(vec_ptr, val, len) \
+    ((void)sizeof(*vec2_data(vec_ptr) = (val)[0]), /* Type-safety enforcement */ \
+     (_vec2_impl_push_repeat)((struct _vec2_impl_struct *)(vec_ptr), \
+        val, len, sizeof(*vec2_data(vec_ptr))))
+
 /**
  * @brief   Pushes multiple elements to the end of a <code>vec</code>
  *
@@ -607,6 +2169,80 @@ extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size
 #define vec2_push_ptr(vec_ptr, val) \
     vec2_push_multi(vec_ptr, val, 1)
 
+/**
+ * @brief   Makes room for multiple elements at a specific index in a <code>vec</code>
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] idx       The index at which to make room for the elements.
+ * @param[in] len       The amount of elements to make room for.
+ *
+ * @note      The new elements are uninitialized, and it's up to the caller to write them
+ *            through the returned pointer, which is invalid after a call to any function which
+ *            mutates the <code>vec</code>. @p len must be an expression that is free from side effects.
+ *
+ * @return    Pointer to the first new element.
+ *            NULL if the insertion failed.
+ */
+#define vec2_emplace_multi(vec_ptr, idx, len) \
+    ((_vec2_impl_create_hole)((struct _vec2_impl_struct *)(vec_ptr), \
+            idx, len, sizeof(*vec2_data(vec_ptr))) ? \
+        ((vec_ptr)->size += (len), &vec2_data(vec_ptr)[(vec_ptr)->_idx[0]]) : \
+        NULL)
+
+/**
+ * @brief   Makes room for an element at a specific index in a <code>vec</code>
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] idx       The index at which to make room for the element.
+ *
+ * @return    Pointer to the new uninitialized element.
+ *            NULL if the insertion failed.
+ */
+#define vec2_emplace_at(vec_ptr, idx) \
+    vec2_emplace_multi(vec_ptr, idx, 1)
+
+/**
+ * @brief   Makes room for an element at the end of a <code>vec</code>
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ *
+ * @return    Pointer to the new uninitialized element.
+ *            NULL if the insertion failed.
+ */
+#define vec2_emplace_back(vec_ptr) \
+    vec2_emplace_multi(vec_ptr, vec2_size(vec_ptr), 1)
+
+/**
+ * @brief   Makes room for multiple elements at the end of a <code>vec</code>
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] len       The amount of elements to make room for.
+ *
+ * @return    Pointer to the first new uninitialized element.
+ *            NULL if the insertion failed.
+ */
+#define vec2_extend_uninit(vec_ptr, len) \
+    vec2_emplace_multi(vec_ptr, vec2_size(vec_ptr), len)
+
+/**
+ * @brief   Moves all the elements of a <code>vec</code> to the end of another <code>vec</code>
+ *
+ * @param[in] dst_ptr   Pointer to the <code>vec</code> structure to append to.
+ * @param[in] src_ptr   Pointer to the <code>vec</code> structure whose elements are moved.
+ *
+ * @note      @p src_ptr is left empty. When both <code>vec</code>s use the same allocator and
+ *            alignment, the buffer of @p src_ptr is taken over instead of copied if @p dst_ptr is
+ *            empty, or if the elements of @p dst_ptr are fewer and fit in front of the elements
+ *            of @p src_ptr. Otherwise the elements are copied after a single reservation.
+ *
+ * @return    TRUE if the elements were moved.
+ *            FALSE otherwise, in which case both <code>vec</code>s are left unchanged.
+ */
+#define vec2_append_vec(dst_ptr, src_ptr) \
+    ((void)sizeof(vec2_data(dst_ptr) == vec2_data(src_ptr)), /* Type-safety enforcement */ \
+     (_vec2_impl_append)((struct _vec2_impl_struct *)(dst_ptr), \
+        (struct _vec2_impl_struct *)(src_ptr), sizeof(*vec2_data(dst_ptr))))
+
 /**
  * @brief   Insert a value to the beginning of a <code>vec</code>
  *
@@ -660,6 +2296,154 @@ extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size
      (_vec2_impl_remove)((struct _vec2_impl_struct *)(vec_ptr), \
         idx, len, sizeof(*vec2_data(vec_ptr)), out))
 
+/**
+ * @brief   Removes multiple elements from a <code>vec</code> in a single pass, preserving the order
+ *
+ * @param[in]  vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in]  idx_arr   Pointer to an array of the indices of the elements to remove, in
+ *                       strictly ascending order.
+ * @param[in]  count     The number of indices in @p idx_arr.
+ * @param[out] out       Optional pointer to an array of @p count elements to store the
+ *                       removed elements in.
+ *
+ * @note      Every kept element is moved at most once, and a removed prefix is dropped by
+ *            advancing the start of the <code>vec</code> rather than by moving the rest.
+ *
+ * @return    TRUE if the removal succeeded.
+ *            FALSE otherwise, in which case the <code>vec</code> is left unchanged.
+ */
+#define vec2_remove_indices(vec_ptr, idx_arr, count, out) \
+    ((void)sizeof(vec2_data(vec_ptr) == (out)), /* Type-safety enforcement */ \
+     (_vec2_impl_remove_indices)((struct _vec2_impl_struct *)(vec_ptr), \
+        idx_arr, count, sizeof(*vec2_data(vec_ptr)), out))
+
+/**
+ * @brief   Removes an element from a <code>vec</code> in constant time, without preserving the order
+ *
+ * @param[in]  vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in]  idx       The index of the element to remove.
+ * @param[out] out       Optional pointer to store the removed element in.
+ *
+ * @note      The last element is moved to the place of the removed element (unless it's the
+ *            first element, in which case the rest of the elements stay where they are).
+ *
+ * @return    TRUE if the removal succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_swap_remove(vec_ptr, idx, out) \
+    ((void)sizeof(vec2_data(vec_ptr) == (out)), /* Type-safety enforcement */ \
+     (_vec2_impl_swap_remove)((struct _vec2_impl_struct *)(vec_ptr), \
+        idx, sizeof(*vec2_data(vec_ptr)), out))
+
+/**
+ * @brief   Removes multiple elements from a <code>vec</code> without preserving the order
+ *
+ * @param[in]  vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in]  idx_arr   Pointer to an array of the indices of the elements to remove, in
+ *                       strictly ascending order.
+ * @param[in]  count     The number of indices in @p idx_arr.
+ * @param[out] out       Optional pointer to an array of @p count elements to store the
+ *                       removed elements in, in the order of @p idx_arr.
+ *
+ * @note      Each removed element is replaced by an element from the end of the <code>vec</code>,
+ *            so the cost doesn't depend on the size of the <code>vec</code>.
+ *
+ * @return    TRUE if the removal succeeded.
+ *            FALSE otherwise, in which case the <code>vec</code> is left unchanged.
+ */
+#define vec2_swap_remove_multi(vec_ptr, idx_arr, count, out) \
+    ((void)sizeof(vec2_data(vec_ptr) == (out)), /* Type-safety enforcement */ \
+     (_vec2_impl_swap_remove_indices)((struct _vec2_impl_struct *)(vec_ptr), \
+        idx_arr, count, sizeof(*vec2_data(vec_ptr)), out))
+
+/**
+ * @brief   Keeps only the elements of a <code>vec</code> that match a predicate
+ *
+ * @param[in]  vec_ptr      Pointer to a <code>vec</code> structure.
+ * @param[in]  predfn       Pointer to a function that receives a pointer to an element and
+ *                          @p ctx, and returns non-zero if the element should be kept.
+ * @param[in]  ctx          Context to pass to @p predfn.
+ * @param[out] removed_ptr  Optional pointer to a <code>vec</code> structure of the same type
+ *                          to append the removed elements to.
+ *
+ * @note      The <code>vec</code> is compacted in a single pass, moving each run of kept
+ *            elements once, and the order of the elements is preserved. @p predfn is called
+ *            exactly once for each element, in order, so it may keep state in @p ctx. If
+ *            appending to @p removed_ptr fails, the elements from that point on are kept.
+ *
+ * @return    TRUE if the removal succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_retain(vec_ptr, predfn, ctx, removed_ptr) \
+    ((void)sizeof(predfn(vec2_data(vec_ptr), ctx)), /* Type-safety enforcement */ \
+     (void)sizeof((vec_ptr) == (removed_ptr)), \
+     (_vec2_impl_retain)((struct _vec2_impl_struct *)(vec_ptr), (_vec2_impl_predfn)predfn, ctx, TRUE, \
+        (struct _vec2_impl_struct *)(removed_ptr), sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * @brief   Removes the elements of a <code>vec</code> that match a predicate
+ *
+ * @param[in]  vec_ptr      Pointer to a <code>vec</code> structure.
+ * @param[in]  predfn       Pointer to a function that receives a pointer to an element and
+ *                          @p ctx, and returns non-zero if the element should be removed.
+ * @param[in]  ctx          Context to pass to @p predfn.
+ * @param[out] removed_ptr  Optional pointer to a <code>vec</code> structure of the same type
+ *                          to append the removed elements to.
+ *
+ * @note      Like <code>vec2_retain</code>, @p predfn is called exactly once for each element,
+ *            in order.
+ *
+ * @return    TRUE if the removal succeeded.
+ *            FALSE otherwise.
+ */
+#define vec2_remove_if(vec_ptr, predfn, ctx, removed_ptr) \
+    ((void)sizeof(predfn(vec2_data(vec_ptr), ctx)), /* Type-safety enforcement */ \
+     (void)sizeof((vec_ptr) == (removed_ptr)), \
+     (_vec2_impl_retain)((struct _vec2_impl_struct *)(vec_ptr), (_vec2_impl_predfn)predfn, ctx, FALSE, \
+        (struct _vec2_impl_struct *)(removed_ptr), sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * Defines a function named <code>name</code> that keeps only the elements of a <code>vec</code>
+ * of type <code>vec_type</code> (e.g. <code>struct int_vec</code>) that match <code>pred</code>.
+ *
+ * <code>pred</code> is a function or a function-like macro that receives a pointer to an element
+ * and a <code>void *</code> context, and evaluates to non-zero if the element should be kept.
+ * Since it's known at compile time, it can be inlined into the loop. The defined function has
+ * the signature <code>int name(vec_type *vec_ptr, void *ctx, vec_type *removed_ptr)</code>, and
+ * behaves like <code>vec2_retain</code>.
+ */
+#define VEC2_DEFINE_RETAIN(name, vec_type, pred) \
+    static int name(vec_type *vec_ptr, void *ctx, vec_type *removed_ptr) \
+    { \
+        size_t read_idx, write_idx = 0; \
+        \
+        if (!_vec2_impl_valid(vec_ptr) || (vec_ptr == removed_ptr)) \
+        { \
+            return FALSE; \
+        } \
+        \
+        for (read_idx = 0; read_idx < vec2_size(vec_ptr); ++read_idx) \
+        { \
+            if (pred(&vec_ptr->data[read_idx], ctx)) \
+            { \
+                if (write_idx != read_idx) \
+                { \
+                    vec_ptr->data[write_idx] = vec_ptr->data[read_idx]; \
+                } \
+                \
+                ++write_idx; \
+            } \
+            else if ((removed_ptr != NULL) && !vec2_push(removed_ptr, vec_ptr->data[read_idx])) \
+            { \
+                /* Keep the rest of the elements */ \
+                vec2_remove(vec_ptr, write_idx, read_idx - write_idx, NULL); \
+                return FALSE; \
+            } \
+        } \
+        \
+        return vec2_resize(vec_ptr, write_idx); \
+    }
+
 /**
  * @brief   Clears a <code>vec</code>
  *
@@ -671,4 +2455,51 @@ extern void (_vec2_impl_clear)(struct _vec2_impl_struct *vec_ptr, size_t el_size
 #define vec2_clear(vec_ptr) \
     (_vec2_impl_clear)((struct _vec2_impl_struct *)(vec_ptr), sizeof(*vec2_data(vec_ptr)))
 
+/**
+ * @brief   Makes a <code>vec</code> take ownership of an existing buffer without copying it
+ *
+ * @param[in] vec_ptr   Pointer to a <code>vec</code> structure.
+ * @param[in] buf       Pointer to the buffer to adopt.
+ * @param[in] size      The number of elements in @p buf.
+ * @param[in] capacity  The number of elements that fit in @p buf.
+ *
+ * @note      @p buf must have been allocated by the allocator of the <code>vec</code> (e.g. using
+ *            <code>malloc</code> for the default allocator) with a size of @p capacity elements,
+ *            and must satisfy the alignment of the <code>vec</code>. The current buffer of the
+ *            <code>vec</code> is freed. A fixed capacity <code>vec</code> becomes a regular one.
+ *            The default allocator gets blocks with a stricter alignment than <code>malloc</code>
+ *            guarantees by over-allocating, so a <code>vec</code> with such an alignment that uses
+ *            it can't adopt buffers.
+ *
+ * @return    TRUE if the buffer was adopted.
+ *            FALSE otherwise.
+ */
+#define vec2_adopt(vec_ptr, buf, size, capacity) \
+    ((void)sizeof((vec_ptr)->data = (buf)), /* Type-safety enforcement */ \
+     (_vec2_impl_adopt)((struct _vec2_impl_struct *)(vec_ptr), \
+        buf, size, capacity, sizeof(*vec2_data(vec_ptr))))
+
+/**
+ * @brief   Detaches the buffer of a <code>vec</code> and hands over its ownership to the caller
+ *
+ * @param[in] vec_ptr       Pointer to a <code>vec</code> structure.
+ * @param[out] size_out     Optional pointer to store the number of elements in the buffer.
+ * @param[out] capacity_out Optional pointer to store the number of elements that fit in the buffer.
+ *
+ * @note      The elements are moved to the beginning of the buffer if needed, but never copied
+ *            to a new buffer, unless the <code>vec</code> uses inline storage. The buffer must be
+ *            freed using the allocator of the <code>vec</code> (e.g. <code>free</code> for the default
+ *            allocator), and the <code>vec</code> is left empty. Fixed capacity <code>vec</code>s
+ *            don't own their buffer, so nothing can be taken from them. Neither can
+ *            <code>vec</code>s that use the default allocator with a stricter alignment than
+ *            <code>malloc</code> guarantees, since their buffer isn't a pointer that
+ *            <code>malloc</code> returned.
+ *
+ * @return    Pointer to the detached buffer.
+ *            NULL if the <code>vec</code> has no buffer or if the buffer can't be detached.
+ */
+#define vec2_take(vec_ptr, size_out, capacity_out) \
+    (_vec2_impl_take)((struct _vec2_impl_struct *)(vec_ptr), \
+        size_out, capacity_out, sizeof(*vec2_data(vec_ptr)))
+
 #endif /* !_GENERIC_CVEC_H_ */